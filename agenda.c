@@ -0,0 +1,224 @@
+/**
+ * @file agenda.c
+ * @brief Agendador cooperativo com roda de temporização e __wfi
+ * @author Andre de Oliveira Melo
+ */
+
+ #include "pico/stdlib.h"
+ #include "hardware/sync.h"
+ #include "agenda.h"
+
+ #define FATIA(ms) ((ms) & (AGENDA_FATIAS - 1))
+
+ static tarefa_t *roda[AGENDA_FATIAS];
+ static tarefa_t *prontas = NULL;       // Vencidas antes de entrar, rodam já
+ static uint32_t proximo_ms;            // Próximo milissegundo a examinar na roda
+ static bool iniciada = false;
+ static alarm_id_t despertador = 0;     // Alarme que acorda o __wfi
+ static agenda_stats_t stats;
+
+ static uint32_t agora_ms(void) {
+     return to_ms_since_boot(get_absolute_time());
+ }
+
+ /**
+  * @brief Diferença com sinal entre dois milissegundos, certa na virada do contador
+  */
+ static int32_t diferenca(uint32_t a, uint32_t b) {
+     return (int32_t) (a - b);
+ }
+
+ static void comecar(void) {
+     if (!iniciada) {
+         proximo_ms = agora_ms();
+         iniciada = true;
+     }
+ }
+
+ /**
+  * @brief Põe a tarefa na roda ou, se a roda já passou do vencimento, nas prontas
+  *
+  * Chamada com as interrupções desligadas.
+  */
+ static void inserir(tarefa_t *t) {
+     tarefa_t **lista = diferenca(t->vencimento, proximo_ms) < 0 ? &prontas : &roda[FATIA(t->vencimento)];
+
+     t->proxima = *lista;
+     *lista = t;
+     t->agendada = true;
+ }
+
+ /**
+  * @brief Tira a tarefa da lista onde ela estiver
+  *
+  * Chamada com as interrupções desligadas.
+  */
+ static void remover(tarefa_t *t) {
+     tarefa_t **listas[2] = {&roda[FATIA(t->vencimento)], &prontas};
+
+     for (int i = 0; i < 2 && t->agendada; i++) {
+         for (tarefa_t **p = listas[i]; *p; p = &(*p)->proxima) {
+             if (*p == t) {
+                 *p = t->proxima;
+                 t->agendada = false;
+                 break;
+             }
+         }
+     }
+ }
+
+ void tarefa_init(tarefa_t *t, agenda_funcao_t funcao, void *ctx) {
+     t->funcao = funcao;
+     t->ctx = ctx;
+     t->periodo_ms = 0;
+     t->agendada = false;
+     t->proxima = NULL;
+ }
+
+ /**
+  * @brief Agenda a tarefa para um vencimento, tirando-a de onde estava
+  */
+ static void agendar(tarefa_t *t, uint32_t atraso_ms, uint32_t periodo_ms) {
+     uint32_t estado = save_and_disable_interrupts();
+
+     comecar();
+     remover(t);
+     t->vencimento = agora_ms() + atraso_ms;
+     t->periodo_ms = periodo_ms;
+     inserir(t);
+
+     restore_interrupts(estado);
+ }
+
+ void agenda_depois(tarefa_t *t, uint32_t atraso_ms) {
+     agendar(t, atraso_ms, 0);
+ }
+
+ void agenda_periodica(tarefa_t *t, uint32_t periodo_ms) {
+     agendar(t, periodo_ms, periodo_ms);
+ }
+
+ void agenda_cancelar(tarefa_t *t) {
+     uint32_t estado = save_and_disable_interrupts();
+     remover(t);
+     restore_interrupts(estado);
+ }
+
+ bool agenda_pendente(const tarefa_t *t) {
+     return t->agendada;
+ }
+
+ /**
+  * @brief Tira da agenda uma tarefa vencida e reagenda se for periódica
+  *
+  * A roda anda até o milissegundo de agora, uma fatia por vez; a fatia
+  * onde achou uma tarefa é examinada de novo na próxima chamada.
+  *
+  * @return A tarefa, ou NULL se nada venceu
+  */
+ static tarefa_t *proxima_vencida(void) {
+     uint32_t estado = save_and_disable_interrupts();
+     const uint32_t agora = agora_ms();
+     tarefa_t *t = prontas;
+
+     if (t) {
+         prontas = t->proxima;
+     } else {
+         // Depois de uma volta inteira sem examinar, uma volta cobre todas as fatias
+         if (diferenca(agora, proximo_ms) >= AGENDA_FATIAS) {
+             proximo_ms = agora - AGENDA_FATIAS + 1;
+         }
+
+         while (!t && diferenca(proximo_ms, agora) <= 0) {
+             tarefa_t **p = &roda[FATIA(proximo_ms)];
+
+             while (*p && diferenca((*p)->vencimento, agora) > 0) {
+                 p = &(*p)->proxima;
+             }
+             if (*p) {
+                 t = *p;
+                 *p = t->proxima;
+             } else {
+                 proximo_ms++;
+             }
+         }
+     }
+
+     if (t) {
+         t->agendada = false;
+         if (t->periodo_ms) {
+             t->vencimento += t->periodo_ms;
+             if (diferenca(t->vencimento, agora) <= 0) {
+                 t->vencimento = agora + t->periodo_ms;  // Atrasou mais de um período
+             }
+             inserir(t);
+         }
+     }
+
+     restore_interrupts(estado);
+     return t;
+ }
+
+ static int64_t acordar(alarm_id_t id, void *dados) {
+     despertador = 0;
+     return 0;
+ }
+
+ /**
+  * @brief Dorme em __wfi até o próximo vencimento ou uma interrupção
+  *
+  * As interrupções ficam desligadas da verificação até o __wfi: uma que
+  * chegue no meio fica pendente e acorda o processador na hora, e só é
+  * atendida quando elas voltam.
+  */
+ static void dormir(void) {
+     uint32_t estado = save_and_disable_interrupts();
+     const uint32_t agora = agora_ms();
+     bool tem_vencimento = false;
+     uint32_t vencimento = 0;
+
+     for (int i = 0; i < AGENDA_FATIAS && !prontas; i++) {
+         for (tarefa_t *t = roda[i]; t; t = t->proxima) {
+             if (!tem_vencimento || diferenca(t->vencimento, vencimento) < 0) {
+                 vencimento = t->vencimento;
+                 tem_vencimento = true;
+             }
+         }
+     }
+
+     if (prontas || (tem_vencimento && diferenca(vencimento, agora) <= 0)) {
+         restore_interrupts(estado);
+         return;
+     }
+
+     if (despertador > 0) {
+         cancel_alarm(despertador);
+         despertador = 0;
+     }
+     if (tem_vencimento) {
+         despertador = add_alarm_in_ms(diferenca(vencimento, agora), acordar, NULL, true);
+     }
+
+     uint64_t inicio = time_us_64();
+     __wfi();
+     stats.dormindo_us += time_us_64() - inicio;
+     stats.sonos++;
+
+     restore_interrupts(estado);
+ }
+
+ void agenda_executar(void) {
+     tarefa_t *t;
+
+     comecar();
+     while ((t = proxima_vencida()) != NULL) {
+         stats.execucoes++;
+         t->funcao(t->ctx);
+     }
+
+     dormir();
+ }
+
+ const agenda_stats_t *agenda_stats(void) {
+     return &stats;
+ }
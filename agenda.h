@@ -0,0 +1,94 @@
+/**
+ * @file agenda.h
+ * @brief Agendador cooperativo de tarefas com roda de temporização
+ * @author Andre de Oliveira Melo
+ *
+ * As tarefas são funções curtas que rodam no loop principal, uma depois
+ * da outra, na hora marcada (uma vez ou periodicamente). Ficam numa roda
+ * de AGENDA_FATIAS listas indexadas pelo milissegundo do vencimento, então
+ * agendar e vencer custam O(1) por tarefa. Sem nada vencido o processador
+ * dorme em __wfi até o próximo vencimento ou qualquer interrupção.
+ *
+ * As tarefas são da aplicação (sem alocação) e podem ser agendadas de
+ * interrupções, por exemplo para tratar um botão no loop principal.
+ */
+
+ #ifndef AGENDA_H
+ #define AGENDA_H
+
+ #include "pico/stdlib.h"
+
+ #define AGENDA_FATIAS 64    // Listas da roda, potência de 2
+
+ typedef void (*agenda_funcao_t)(void *ctx);
+
+ /**
+  * @brief Uma tarefa; os campos são do agendador
+  */
+ typedef struct tarefa {
+     agenda_funcao_t funcao;
+     void *ctx;
+     uint32_t vencimento;    // Milissegundo em que vence
+     uint32_t periodo_ms;    // 0 para uma vez só
+     bool agendada;
+     struct tarefa *proxima; // Na lista da fatia
+ } tarefa_t;
+
+ /**
+  * @brief Estatísticas do agendador
+  */
+ typedef struct {
+     uint32_t execucoes;     // Tarefas executadas
+     uint32_t sonos;         // Vezes que o processador dormiu
+     uint64_t dormindo_us;   // Tempo total dormindo
+ } agenda_stats_t;
+
+ /**
+  * @brief Prepara uma tarefa, sem agendar
+  *
+  * @param t Tarefa
+  * @param funcao Função executada no loop principal
+  * @param ctx Argumento da função
+  */
+ void tarefa_init(tarefa_t *t, agenda_funcao_t funcao, void *ctx);
+
+ /**
+  * @brief Agenda a tarefa para daqui a atraso_ms, uma vez
+  *
+  * Se ela já estiver agendada, vale o novo horário. Com atraso 0 ela
+  * roda na próxima volta do loop.
+  */
+ void agenda_depois(tarefa_t *t, uint32_t atraso_ms);
+
+ /**
+  * @brief Agenda a tarefa a cada periodo_ms, a primeira daqui a um período
+  *
+  * Os vencimentos seguem uma grade fixa; se o loop atrasar mais de um
+  * período, a grade recomeça em vez de rodar a tarefa várias vezes seguidas.
+  */
+ void agenda_periodica(tarefa_t *t, uint32_t periodo_ms);
+
+ /**
+  * @brief Tira a tarefa da agenda, se ela estiver lá
+  */
+ void agenda_cancelar(tarefa_t *t);
+
+ /**
+  * @brief Informa se a tarefa está agendada
+  */
+ bool agenda_pendente(const tarefa_t *t);
+
+ /**
+  * @brief Executa as tarefas vencidas e dorme até a próxima
+  *
+  * É o corpo do loop principal. Volta depois de cada interrupção, mesmo
+  * que ela não tenha agendado nada.
+  */
+ void agenda_executar(void);
+
+ /**
+  * @brief Retorna as estatísticas do agendador
+  */
+ const agenda_stats_t *agenda_stats(void);
+
+ #endif
@@ -0,0 +1,271 @@
+/**
+ * @file benchmark.c
+ * @brief Medições de desempenho do driver do display
+ * @author Andre de Oliveira Melo
+ */
+
+ #include <stdio.h>
+ #include <string.h>
+ #include "pico/stdlib.h"
+ #include "benchmark.h"
+ #include "ssd1306/band.h"
+ 
+ #define BENCH_REPETICOES 200  // Repetições de cada medição
+ #define BENCH_QUADROS 20      // Repetições das medições que usam o barramento
+ 
+ /**
+  * @brief Linhas de exemplo, no mesmo formato usado por definir_linhas
+  */
+ static const char *linhas_exemplo[] = {"3 7 1", "0 9 4", "6 2 8", "5 1 7"};
+ static const uint32_t linhas_y[] = {5, 20, 35, 50};
+ 
+ /**
+  * @brief Desenho de caractere original: um quadrado 1x1 por pixel aceso
+  */
+ static void desenhar_caractere_antigo(ssd1306_t *disp, uint32_t x, uint32_t y, char c) {
+     const uint8_t *font = font_8x5;
+     
+     if (c < font[3] || c > font[4]) {
+         return;
+     }
+     
+     for (uint8_t w = 0; w < font[1]; ++w) {
+         uint8_t coluna = font[(c - font[3]) * font[1] + w + 5];
+         
+         for (int8_t j = 0; j < 8; ++j, coluna >>= 1) {
+             if (coluna & 1) {
+                 ssd1306_draw_square(disp, x + w, y + j, 1, 1);
+             }
+         }
+     }
+ }
+ 
+ /**
+  * @brief Desenha as quatro linhas do teclado com o código antigo ou o novo
+  */
+ static void desenhar_teclado(ssd1306_t *disp, bool antigo) {
+     for (int i = 0; i < 4; i++) {
+         if (!antigo) {
+             ssd1306_draw_string(disp, 30, linhas_y[i], 1, linhas_exemplo[i]);
+             continue;
+         }
+         
+         uint32_t x = 30;
+         for (const char *s = linhas_exemplo[i]; *s; s++, x += font_8x5[1] + font_8x5[2]) {
+             desenhar_caractere_antigo(disp, x, linhas_y[i], *s);
+         }
+     }
+ }
+ 
+ /**
+  * @brief Tempo médio, em microssegundos, para desenhar o teclado
+  */
+ static uint32_t medir_teclado(ssd1306_t *disp, bool antigo) {
+     uint64_t inicio = time_us_64();
+     
+     for (int i = 0; i < BENCH_REPETICOES; i++) {
+         ssd1306_clear(disp);
+         desenhar_teclado(disp, antigo);
+     }
+     
+     return (uint32_t)((time_us_64() - inicio) / BENCH_REPETICOES);
+ }
+ 
+ /**
+  * @brief Compara o desenho de glifos antigo (pixel a pixel) com o novo
+  */
+ static void benchmark_glifos(ssd1306_t *disp) {
+     static uint8_t referencia[1024];
+     
+     uint32_t antigo = medir_teclado(disp, true);
+     memcpy(referencia, disp->buffer, disp->bufsize);
+     
+     uint32_t novo = medir_teclado(disp, false);
+     bool iguais = memcmp(referencia, disp->buffer, disp->bufsize) == 0;
+     
+     printf("[bench] glifos: antigo %lu us, novo %lu us por teclado (%lu.%lux), saida %s\n",
+            (unsigned long)antigo, (unsigned long)novo,
+            (unsigned long)(antigo / (novo ? novo : 1)),
+            (unsigned long)((antigo * 10 / (novo ? novo : 1)) % 10),
+            iguais ? "identica" : "DIFERENTE");
+ }
+ 
+ /**
+  * @brief Monta em memória um BMP monocromático com padrão xadrez
+  * 
+  * @return Tamanho do arquivo em bytes
+  */
+ static long montar_bmp(uint8_t *bmp, uint32_t largura, uint32_t altura) {
+     uint32_t bytes_linha = ((largura + 31) / 32) * 4;
+     uint32_t inicio = 62;  // Cabeçalhos (14 + 40) e paleta (2 cores)
+     
+     memset(bmp, 0, inicio + bytes_linha * altura);
+     bmp[0] = 'B';
+     bmp[1] = 'M';
+     bmp[10] = inicio;
+     bmp[14] = 40;
+     bmp[18] = largura;
+     bmp[22] = altura;
+     bmp[26] = 1;
+     bmp[28] = 1;
+     memset(&bmp[58], 0xFF, 3);  // Cor 0 preta, cor 1 branca
+     
+     for (uint32_t y = 0; y < altura; y++) {
+         for (uint32_t b = 0; b < bytes_linha; b++) {
+             bmp[inicio + y * bytes_linha + b] = (y & 4) ? 0xF0 : 0x0F;
+         }
+     }
+     
+     return inicio + bytes_linha * altura;
+ }
+ 
+ /**
+  * @brief Decodificação original de BMP: um ssd1306_draw_pixel por pixel
+  */
+ static void desenhar_bmp_antigo(ssd1306_t *disp, const uint8_t *bmp, uint32_t x0, uint32_t y0) {
+     uint32_t largura = bmp[18];
+     uint32_t altura = bmp[22];
+     uint32_t bytes_linha = ((largura + 31) / 32) * 4;
+     const uint8_t *dados = bmp + bmp[10];
+     
+     for (uint32_t y = altura; y-- > 0; dados += bytes_linha) {
+         for (uint32_t x = 0; x < largura; x++) {
+             if (((dados[x >> 3] >> (7 - (x & 7))) & 1) == 0) {
+                 ssd1306_draw_pixel(disp, x0 + x, y0 + y);
+             }
+         }
+     }
+ }
+ 
+ /**
+  * @brief Mede uma imagem com o código antigo e o novo e imprime a vazão
+  */
+ static void medir_bmp(ssd1306_t *disp, const char *nome, const uint8_t *bmp, long tamanho, uint32_t x0, uint32_t y0) {
+     static uint8_t referencia[1024];
+     uint32_t pixels = bmp[18] * bmp[22];
+     uint64_t tempo[2];
+     
+     for (int novo = 0; novo < 2; novo++) {
+         uint64_t inicio = time_us_64();
+         
+         for (int i = 0; i < BENCH_REPETICOES; i++) {
+             ssd1306_clear(disp);
+             if (novo) {
+                 ssd1306_bmp_show_image_with_offset(disp, bmp, tamanho, x0, y0);
+             } else {
+                 desenhar_bmp_antigo(disp, bmp, x0, y0);
+             }
+         }
+         
+         tempo[novo] = (time_us_64() - inicio) / BENCH_REPETICOES;
+         if (!novo) {
+             memcpy(referencia, disp->buffer, disp->bufsize);
+         }
+     }
+     
+     bool iguais = memcmp(referencia, disp->buffer, disp->bufsize) == 0;
+     
+     printf("[bench] bmp %s: antigo %lu us (%lu px/ms), novo %lu us (%lu px/ms), saida %s\n",
+            nome,
+            (unsigned long)tempo[0], (unsigned long)(pixels * 1000 / (tempo[0] ? tempo[0] : 1)),
+            (unsigned long)tempo[1], (unsigned long)(pixels * 1000 / (tempo[1] ? tempo[1] : 1)),
+            iguais ? "identica" : "DIFERENTE");
+ }
+ 
+ /**
+  * @brief Compara a decodificação de BMP pixel a pixel com a transposição 8x8
+  */
+ static void benchmark_bmp(ssd1306_t *disp) {
+     static uint8_t bmp[62 + 16 * 64];
+     
+     long tamanho = montar_bmp(bmp, 128, 64);
+     medir_bmp(disp, "tela cheia 128x64", bmp, tamanho, 0, 0);
+     
+     tamanho = montar_bmp(bmp, 48, 24);
+     medir_bmp(disp, "parcial 48x24", bmp, tamanho, 40, 16);
+ }
+ 
+ /**
+  * @brief Mede o custo de ssd1306_draw_pixel na tela inteira
+  * 
+  * Comparar a saída de compilações com e sem SSD1306_STATIC_GEOMETRY
+  * mostra o ganho da geometria fixa em tempo de compilação.
+  */
+ static void benchmark_pixels(ssd1306_t *disp) {
+     uint32_t pixels = disp->width * disp->height;
+     uint64_t inicio = time_us_64();
+     
+     for (int i = 0; i < BENCH_REPETICOES; i++) {
+         ssd1306_clear(disp);
+         for (uint32_t y = 0; y < disp->height; y++) {
+             for (uint32_t x = 0; x < disp->width; x++) {
+                 ssd1306_draw_pixel(disp, x, y);
+             }
+         }
+     }
+     
+     uint64_t total = time_us_64() - inicio;
+     
+ #ifdef SSD1306_STATIC_GEOMETRY
+     const char *modo = "fixa";
+ #else
+     const char *modo = "dinamica";
+ #endif
+     printf("[bench] pixels (geometria %s): %lu us por tela, %lu ns por pixel\n", modo,
+            (unsigned long)(total / BENCH_REPETICOES),
+            (unsigned long)(total * 1000 / ((uint64_t)BENCH_REPETICOES * pixels)));
+ }
+ 
+ /**
+  * @brief Compara o quadro do teclado com framebuffer e com o renderizador por faixas
+  * 
+  * As duas versões enviam a tela inteira a cada quadro. O renderizador por
+  * faixas começa a enviar após compor a primeira página e usa só uma página
+  * de memória.
+  */
+ static void benchmark_banda(ssd1306_t *disp) {
+     static ssd1306_band_t banda;
+     ssd1306_op_t operacoes[8];
+     ssd1306_dlist_t lista;
+     
+     ssd1306_dlist_init(&lista, operacoes, 8, disp->width, disp->height);
+     for (int i = 0; i < 4; i++) {
+         ssd1306_dlist_string(&lista, 30, linhas_y[i], 1, linhas_exemplo[i]);
+     }
+     ssd1306_dlist_invert_rect(&lista, 20, linhas_y[1], 3, 5);
+     
+     uint64_t inicio = time_us_64();
+     for (int i = 0; i < BENCH_QUADROS; i++) {
+         ssd1306_clear(disp);
+         desenhar_teclado(disp, false);
+         ssd1306_invert_rect(disp, 20, linhas_y[1], 3, 5);
+         ssd1306_show(disp);
+     }
+     uint32_t tempo_fb = (time_us_64() - inicio) / BENCH_QUADROS;
+     
+     ssd1306_band_init(&banda, disp->width, disp->height, disp->external_vcc, disp->transport);
+     inicio = time_us_64();
+     for (int i = 0; i < BENCH_QUADROS; i++) {
+         ssd1306_band_invalidate(&banda);
+         ssd1306_band_render(&banda, &lista);
+     }
+     uint32_t tempo_banda = (time_us_64() - inicio) / BENCH_QUADROS;
+     
+ #ifdef SSD1306_STATIC_GEOMETRY
+     uint32_t memoria_fb = sizeof(ssd1306_t);
+ #else
+     uint32_t memoria_fb = sizeof(ssd1306_t) + 2 * (disp->bufsize + 1);
+ #endif
+     printf("[bench] banda: framebuffer %lu us e %lu bytes, faixas %lu us e %lu bytes por quadro\n",
+            (unsigned long)tempo_fb, (unsigned long)memoria_fb,
+            (unsigned long)tempo_banda, (unsigned long)(sizeof(banda) + sizeof(operacoes)));
+ }
+ 
+ void benchmark_executar(ssd1306_t *disp) {
+     benchmark_pixels(disp);
+     benchmark_glifos(disp);
+     benchmark_bmp(disp);
+     benchmark_banda(disp);
+     
+     ssd1306_clear(disp);
+ }
@@ -0,0 +1,22 @@
+/**
+ * @file benchmark.h
+ * @brief Medições de desempenho do driver do display
+ * @author Andre de Oliveira Melo
+ * 
+ * Compilado apenas com a opção SRK_BENCHMARK do CMake. Os resultados
+ * são impressos pela saída padrão (USB) na inicialização.
+ */
+
+ #ifndef BENCHMARK_H
+ #define BENCHMARK_H
+ 
+ #include "ssd1306/ssd1306.h"
+ 
+ /**
+  * @brief Executa todas as medições, usando o buffer do display
+  * 
+  * @param disp Display já inicializado (o buffer é apagado ao final)
+  */
+ void benchmark_executar(ssd1306_t *disp);
+ 
+ #endif
@@ -0,0 +1,49 @@
+/**
+ * @file eventos.c
+ * @brief Anel de eventos de entrada, um produtor e um consumidor
+ * @author Andre de Oliveira Melo
+ */
+
+ #include "pico/stdlib.h"
+ #include "hardware/sync.h"
+ #include "eventos.h"
+
+ // Índices correm livres; a posição no anel é o índice módulo EVENTOS_TAMANHO
+ static evento_t anel[EVENTOS_TAMANHO];
+ static volatile uint32_t cabeca = 0;   // Escrito só pelo produtor
+ static volatile uint32_t cauda = 0;    // Escrito só pelo consumidor
+ static volatile uint32_t perdidos = 0; // Escrito só pelo produtor
+
+ bool eventos_publicar(evento_tipo_t tipo, uint32_t tempo_us) {
+     const uint32_t c = cabeca;
+
+     if (c - cauda == EVENTOS_TAMANHO) {
+         perdidos++;
+         return false;
+     }
+
+     anel[c % EVENTOS_TAMANHO].tempo_us = tempo_us;
+     anel[c % EVENTOS_TAMANHO].tipo = tipo;
+     __dmb();  // O evento fica visível antes da cabeça nova
+     cabeca = c + 1;
+     return true;
+ }
+
+ uint32_t eventos_retirar(evento_t *destino, uint32_t max) {
+     const uint32_t c = cabeca;
+     uint32_t t = cauda;
+     uint32_t n = 0;
+
+     __dmb();  // Lê os eventos só depois da cabeça
+     while (t != c && n < max) {
+         destino[n++] = anel[t % EVENTOS_TAMANHO];
+         t++;
+     }
+     __dmb();  // Termina de ler antes de liberar as posições
+     cauda = t;
+     return n;
+ }
+
+ uint32_t eventos_perdidos(void) {
+     return perdidos;
+ }
@@ -0,0 +1,62 @@
+/**
+ * @file eventos.h
+ * @brief Fila de eventos de entrada das interrupções para o loop principal
+ * @author Andre de Oliveira Melo
+ *
+ * Anel de um produtor e um consumidor, sem trava: as interrupções
+ * (botão e amostragem do joystick) publicam, o loop principal retira em
+ * lotes. O produtor só escreve a cabeça e o consumidor só escreve a cauda.
+ * As interrupções que publicam devem ter a mesma prioridade, para uma
+ * não interromper a outra no meio de uma publicação; juntas elas são o
+ * único produtor.
+ */
+
+ #ifndef EVENTOS_H
+ #define EVENTOS_H
+
+ #include "pico/stdlib.h"
+
+ #define EVENTOS_TAMANHO 32  // Eventos na fila, potência de 2
+
+ /**
+  * @brief Tipos de evento
+  */
+ typedef enum {
+     EVENTO_BOTAO_DESCE,     // Botão apertado (borda de descida)
+     EVENTO_BOTAO_SOBE,      // Botão solto (borda de subida)
+     EVENTO_JOYSTICK_CIMA,   // Joystick para cima numa amostra
+     EVENTO_JOYSTICK_BAIXO   // Joystick para baixo numa amostra
+ } evento_tipo_t;
+
+ /**
+  * @brief Um evento de entrada
+  */
+ typedef struct {
+     uint32_t tempo_us;      // time_us_32 de quando aconteceu
+     uint8_t tipo;           // evento_tipo_t
+ } evento_t;
+
+ /**
+  * @brief Publica um evento; só o produtor (contexto de interrupção) chama
+  *
+  * @param tipo Tipo do evento
+  * @param tempo_us Quando ele aconteceu
+  * @return false se a fila estava cheia (o evento entra na conta dos perdidos)
+  */
+ bool eventos_publicar(evento_tipo_t tipo, uint32_t tempo_us);
+
+ /**
+  * @brief Retira eventos na ordem em que chegaram; só o consumidor chama
+  *
+  * @param destino Onde copiar os eventos
+  * @param max Quantos cabem em destino
+  * @return Quantos eventos foram retirados
+  */
+ uint32_t eventos_retirar(evento_t *destino, uint32_t max);
+
+ /**
+  * @brief Eventos descartados por fila cheia desde o início
+  */
+ uint32_t eventos_perdidos(void);
+
+ #endif
@@ -0,0 +1,198 @@
+/**
+* @file emu_report.c
+*
+* runs the driver against the emulated display and prints what each way
+* of updating the screen costs on the bus. the panel is compared with the
+* framebuffer after every step.
+*
+* usage: emu_report [panel.pbm]
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ssd1306.h"
+#include "tilemap.h"
+#include "gray.h"
+#include "ssd1306_emu.h"
+
+static ssd1306_emu_t emu;
+static ssd1306_mock_t mock;
+static ssd1306_t disp;
+static uint32_t errors;
+
+// pixels of the panel that differ from a page-format buffer
+static uint32_t panel_mismatches(const uint8_t *buffer) {
+    uint32_t n=0;
+
+    for(uint32_t y=0; y<disp.height; ++y)
+        for(uint32_t x=0; x<disp.width; ++x) {
+            const bool fb=buffer[(y>>3)*disp.width+x]>>(y&7)&1;
+            if(fb!=ssd1306_emu_pixel(&emu, x, y))
+                ++n;
+        }
+
+    return n;
+}
+
+static void report_against(const char *label, const uint8_t *expected) {
+    ssd1306_emu_counts_t c;
+    ssd1306_emu_end_frame(&emu, &c);
+    ssd1306_emu_print(stdout, label, &c);
+
+    const uint32_t n=panel_mismatches(expected);
+    if(n) {
+        printf("%-24s %u pixels differ from what was sent\n", "", n);
+        ++errors;
+    }
+}
+
+static void report(const char *label) {
+    report_against(label, disp.buffer);
+}
+
+static void count_flush_done(ssd1306_t *p, void *ctx) {
+    (void) p;
+    ++*(uint32_t *) ctx;
+}
+
+int main(int argc, char **argv) {
+    ssd1306_emu_init(&emu, 128, 64);
+
+    ssd1306_transport_t *t=ssd1306_mock_init(&mock, NULL, 0);
+    ssd1306_mock_set_sink(&mock, ssd1306_emu_sink, &emu);
+    if(!ssd1306_init_transport(&disp, 128, 64, t)) {
+        fprintf(stderr, "emu_report: init failed\n");
+        return 1;
+    }
+    report("init");
+
+    // whole screen of text, then the same screen again
+    for(uint32_t line=0; line<8; ++line)
+        ssd1306_draw_string(&disp, 0, line*8, 1, "0123456789ABCDEFGHIJ");
+    ssd1306_show(&disp);
+    report("full frame");
+
+    ssd1306_mark_dirty(&disp, 0, 0, disp.width, disp.height);
+    ssd1306_show(&disp);
+    report("full frame, unchanged");
+
+    // cursor moving by one glyph
+    ssd1306_clear(&disp);
+    ssd1306_show(&disp);
+    ssd1306_emu_end_frame(&emu, NULL);
+    ssd1306_fill_rect(&disp, 40, 48, 6, 8);
+    ssd1306_show(&disp);
+    report("cursor, show");
+
+    ssd1306_clear_rect(&disp, 40, 48, 6, 8);
+    ssd1306_fill_rect(&disp, 46, 48, 6, 8);
+    ssd1306_show(&disp);
+    report("cursor moved, show");
+
+    // password field: one more asterisk through the tile map
+    static const uint8_t tiles[2*SSD1306_TILE_BYTES]= {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0x00, 0x2a, 0x1c, 0x7f, 0x1c, 0x2a, 0x00, 0x00,
+    };
+    ssd1306_tilemap_t map;
+    ssd1306_tilemap_init(&map, &disp, tiles, 2);
+    for(uint32_t i=0; i<8; ++i)
+        ssd1306_tilemap_set(&map, 4+i, 2, 0);
+    ssd1306_tilemap_flush(&map);
+    report("tile map, 8 cells");
+
+    ssd1306_tilemap_set(&map, 4, 2, 1);
+    ssd1306_tilemap_flush(&map);
+    report("tile map, 1 asterisk");
+
+    // a cell given back to the framebuffer loses its tile
+    ssd1306_tilemap_set(&map, 4, 2, SSD1306_TILE_NONE);
+    ssd1306_tilemap_flush(&map);
+    report("tile map, cell released");
+    for(uint32_t i=0; i<SSD1306_TILE_BYTES; ++i)
+        if(disp.buffer[2*disp.width+4*8+i]) {
+            printf("%-24s old tile left in the framebuffer\n", "");
+            ++errors;
+            break;
+        }
+
+    // two changes far apart: async sends a window per page, like show
+    ssd1306_draw_pixel(&disp, 2, 1);
+    ssd1306_draw_pixel(&disp, 120, 62);
+    ssd1306_show_async(&disp, NULL, NULL);
+    ssd1306_show_wait(&disp);
+    report("async, 2 far pixels");
+
+    ssd1306_draw_pixel(&disp, 3, 1);
+    ssd1306_draw_pixel(&disp, 121, 62);
+    ssd1306_show(&disp);
+    report("show, 2 far pixels");
+
+    // the display does not acknowledge the first window: the second is not sent
+    uint32_t flushes_done=0;
+    const uint32_t writes=mock.cmd_writes+mock.data_writes;
+    mock.fail_async=1;
+    ssd1306_draw_pixel(&disp, 4, 1);
+    ssd1306_draw_pixel(&disp, 122, 62);
+    ssd1306_show_async(&disp, count_flush_done, &flushes_done);
+    ssd1306_show_wait(&disp);
+    if(mock.cmd_writes+mock.data_writes!=writes || flushes_done!=1) {
+        printf("%-24s %u writes after the nack, %u completions\n", "async, nack", mock.cmd_writes+mock.data_writes-writes, flushes_done);
+        ++errors;
+    }
+    ssd1306_mark_dirty(&disp, 4, 1, 1, 1);
+    ssd1306_mark_dirty(&disp, 122, 62, 1, 1);
+    ssd1306_show(&disp);
+    report("show, after a nack");
+
+    // grayscale: keypad rows dimmed but the selected one, one cycle of planes
+    static ssd1306_gray_t gray;
+    ssd1306_gray_init(&gray, &disp);
+    ssd1306_clear(&disp);
+    for(uint32_t row=0; row<4; ++row)
+        ssd1306_draw_string(&disp, 30, 5+row*15, 1, "1  2  3");
+    ssd1306_gray_from_mono(&gray, 0, 0, disp.width, disp.height, SSD1306_GRAY_MAX);
+    ssd1306_gray_from_mono(&gray, 30, 20, disp.width-30, 40, 1);
+    ssd1306_gray_commit(&gray);
+    ssd1306_gray_start(&gray, 180); // no timer on the host, stepped below
+    for(uint32_t cycle=0; cycle<2; ++cycle) {
+        static const char *const labels[2][SSD1306_GRAY_CYCLE]= {
+            {"gray, first plane", "gray, high plane", "gray, low plane"},
+            {"gray, high plane", "gray, high plane", "gray, low plane"},
+        };
+        for(uint32_t slot=0; slot<SSD1306_GRAY_CYCLE; ++slot) {
+            ssd1306_gray_step(&gray);
+            report_against(labels[cycle][slot], gray.front[gray.shown]);
+        }
+    }
+
+    // the cursor moves: only the rows that changed level go out
+    ssd1306_gray_from_mono(&gray, 30, 5, disp.width-30, 10, 1);
+    ssd1306_gray_from_mono(&gray, 30, 20, disp.width-30, 10, SSD1306_GRAY_MAX);
+    ssd1306_gray_commit(&gray);
+    for(uint32_t slot=0; slot<SSD1306_GRAY_CYCLE; ++slot) {
+        ssd1306_gray_step(&gray);
+        report_against("gray, cursor moved", gray.front[gray.shown]);
+    }
+    ssd1306_gray_stop(&gray);
+
+    printf("\n");
+    ssd1306_emu_print(stdout, "total", &emu.total);
+    if(emu.unknown_cmds || emu.scroll_writes) {
+        printf("%u unknown command bytes, %u bytes written while scrolling\n", emu.unknown_cmds, emu.scroll_writes);
+        ++errors;
+    }
+
+    if(argc>1) {
+        FILE *f=fopen(argv[1], "w");
+        if(!f) {
+            perror(argv[1]);
+            return 1;
+        }
+        ssd1306_emu_write_pbm(&emu, f);
+        fclose(f);
+    }
+
+    return errors?1:0;
+}
@@ -0,0 +1,79 @@
+#ifndef _inc_host_hardware_dma
+#define _inc_host_hardware_dma
+#include "pico/stdlib.h"
+
+// no channel can be claimed, so transports never start a dma transfer
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size {DMA_SIZE_8=0, DMA_SIZE_16=1, DMA_SIZE_32=2};
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+static inline int dma_claim_unused_channel(bool required) {
+    (void) required;
+    return -1;
+}
+
+static inline void dma_channel_unclaim(uint ch) {
+    (void) ch;
+}
+
+static inline dma_channel_config dma_channel_get_default_config(uint ch) {
+    dma_channel_config c= {ch};
+    return c;
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    (void) c; (void) size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    (void) c; (void) incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    (void) c; (void) incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    (void) c; (void) dreq;
+}
+
+static inline void dma_channel_configure(uint ch, const dma_channel_config *c, volatile void *write_addr, const volatile void *read_addr, uint count, bool trigger) {
+    (void) ch; (void) c; (void) write_addr; (void) read_addr; (void) count; (void) trigger;
+}
+
+static inline void dma_channel_set_read_addr(uint ch, const volatile void *addr, bool trigger) {
+    (void) ch; (void) addr; (void) trigger;
+}
+
+static inline void dma_channel_set_trans_count(uint ch, uint32_t count, bool trigger) {
+    (void) ch; (void) count; (void) trigger;
+}
+
+static inline bool dma_channel_is_busy(uint ch) {
+    (void) ch;
+    return false;
+}
+
+static inline void dma_channel_abort(uint ch) {
+    (void) ch;
+}
+
+static inline void dma_channel_set_irq0_enabled(uint ch, bool enabled) {
+    (void) ch; (void) enabled;
+}
+
+static inline bool dma_channel_get_irq0_status(uint ch) {
+    (void) ch;
+    return false;
+}
+
+static inline void dma_channel_acknowledge_irq0(uint ch) {
+    (void) ch;
+}
+
+#endif
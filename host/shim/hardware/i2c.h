@@ -0,0 +1,8 @@
+#ifndef _inc_host_hardware_i2c
+#define _inc_host_hardware_i2c
+#include "pico/stdlib.h"
+
+// only the type, the i2c transport is not built for the host
+typedef struct i2c_inst i2c_inst_t;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _inc_host_hardware_spi
+#define _inc_host_hardware_spi
+#include "pico/stdlib.h"
+
+// only the type, the spi transport is not built for the host
+typedef struct spi_inst spi_inst_t;
+
+#endif
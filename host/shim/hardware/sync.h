@@ -0,0 +1,7 @@
+#ifndef _inc_host_hardware_sync
+#define _inc_host_hardware_sync
+
+// interrupts are declared with the rest of the host shim
+#include "pico/stdlib.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _inc_host_pico_binary_info
+#define _inc_host_pico_binary_info
+
+// binary info only exists in rp2040 images
+
+#endif
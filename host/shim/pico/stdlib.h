@@ -0,0 +1,74 @@
+/**
+* @file stdlib.h
+*
+* the part of the pico sdk the display driver uses, for host builds.
+* time comes from the host clock, there is no dma: async flushes fall
+* back to blocking writes. repeating timers never fire.
+*/
+
+#ifndef _inc_host_pico_stdlib
+#define _inc_host_pico_stdlib
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+void sleep_us(uint64_t us);
+
+static inline uint32_t time_us_32(void) {
+    return (uint32_t) time_us_64();
+}
+
+static inline void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t) ms*1000);
+}
+
+static inline void busy_wait_us_32(uint32_t us) {
+    sleep_us(us);
+}
+
+static inline void tight_loop_contents(void) {
+}
+
+static inline uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status) {
+    (void) status;
+}
+
+// no timer interrupts on the host, whoever uses a repeating timer is stepped by hand
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+
+struct repeating_timer {
+    int64_t delay_us;
+    repeating_timer_callback_t callback;
+    void *user_data;
+};
+
+static inline bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+    out->delay_us=delay_us;
+    out->callback=callback;
+    out->user_data=user_data;
+    return false;
+}
+
+static inline bool cancel_repeating_timer(repeating_timer_t *timer) {
+    (void) timer;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
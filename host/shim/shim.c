@@ -0,0 +1,26 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "ssd1306.h"
+
+uint64_t time_us_64(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+void sleep_us(uint64_t us) {
+    const struct timespec ts= {(time_t)(us/1000000), (long)(us%1000000)*1000};
+
+    nanosleep(&ts, NULL);
+}
+
+// the host has no i2c controller: ssd1306_init gets a mock transport that drops every byte
+ssd1306_transport_t *ssd1306_i2c_init(ssd1306_i2c_t *t, i2c_inst_t *i2c, uint8_t address) {
+    static ssd1306_mock_t mock;
+
+    (void) t; (void) i2c; (void) address;
+    return ssd1306_mock_init(&mock, NULL, 0);
+}
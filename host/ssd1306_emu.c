@@ -0,0 +1,251 @@
+/**
+* @file ssd1306_emu.c
+*
+* ssd1306 command and data parser for the host emulator, with the byte,
+* transaction and bus time counters of each frame
+*/
+
+#include <string.h>
+
+#include "ssd1306_emu.h"
+
+// bytes of a command, its arguments included
+static uint8_t ssd1306_emu_cmd_size(uint8_t c) {
+    switch(c) {
+    case 0x81:	// contrast
+    case 0x20:	// memory addressing mode
+    case 0xA8:	// multiplex ratio
+    case 0xD3:	// display offset
+    case 0xD5:	// clock divide
+    case 0xD9:	// precharge
+    case 0xDA:	// com pins
+    case 0xDB:	// vcomh deselect
+    case 0x8D:	// charge pump
+        return 2;
+    case 0x21:	// column address
+    case 0x22:	// page address
+    case 0xA3:	// vertical scroll area
+        return 3;
+    case 0x29:	// vertical and horizontal scroll
+    case 0x2A:
+        return 6;
+    case 0x26:	// horizontal scroll
+    case 0x27:
+        return 7;
+    default:
+        return 1;
+    }
+}
+
+static void ssd1306_emu_cmd(ssd1306_emu_t *e, const uint8_t *c) {
+    switch(c[0]) {
+    case 0x81: e->contrast=c[1]; return;
+    case 0x20: e->mode=c[1]&3; return;
+    case 0xA8: e->mux=c[1]&0x3F; return;
+    case 0xD3: e->offset=c[1]&0x3F; return;
+    case 0x8D: e->charge_pump=c[1]&0x04; return;
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB: case 0xA3: return;
+    case 0x21:
+        e->col_start=e->col=c[1]&0x7F;
+        e->col_end=c[2]&0x7F;
+        return;
+    case 0x22:
+        e->page_start=e->page=c[1]&7;
+        e->page_end=c[2]&7;
+        return;
+    case 0x26: case 0x27: case 0x29: case 0x2A: return; // take effect with 0x2F
+    case 0x2E: e->scrolling=false; return;
+    case 0x2F: e->scrolling=true; return;
+    case 0xA0: case 0xA1: e->seg_remap=c[0]&1; return;
+    case 0xC0: case 0xC8: e->com_remap=c[0]&8; return;
+    case 0xA4: case 0xA5: e->entire_on=c[0]&1; return;
+    case 0xA6: case 0xA7: e->invert=c[0]&1; return;
+    case 0xAE: case 0xAF: e->display_on=c[0]&1; return;
+    case 0xE3: return; // nop
+    }
+
+    if(c[0]>=0x40 && c[0]<=0x7F)
+        e->start_line=c[0]&0x3F;
+    else if(c[0]>=0xB0 && c[0]<=0xB7)
+        e->page=c[0]&7;
+    else if(c[0]<=0x0F)
+        e->col=(e->col&0xF0)|c[0];
+    else if(c[0]>=0x10 && c[0]<=0x17)
+        e->col=(e->col&0x0F)|(c[0]&7)<<4;
+    else
+        ++e->unknown_cmds;
+}
+
+static void ssd1306_emu_cmd_byte(ssd1306_emu_t *e, uint8_t b) {
+    ++e->frame.cmd_bytes;
+
+    if(!e->cmd_len)
+        e->cmd_need=ssd1306_emu_cmd_size(b);
+
+    e->cmd[e->cmd_len++]=b;
+    if(e->cmd_len<e->cmd_need)
+        return;
+
+    ssd1306_emu_cmd(e, e->cmd);
+    e->cmd_len=0;
+}
+
+static void ssd1306_emu_data_byte(ssd1306_emu_t *e, uint8_t b) {
+    ++e->frame.data_bytes;
+    if(e->scrolling)
+        ++e->scroll_writes;
+
+    uint8_t *cell=&e->ram[e->page&7][e->col&0x7F];
+    if(*cell==b)
+        ++e->frame.redundant_bytes;
+    *cell=b;
+
+    switch(e->mode) {
+    case 0: // horizontal
+        if(e->col++>=e->col_end) {
+            e->col=e->col_start;
+            if(e->page++>=e->page_end)
+                e->page=e->page_start;
+        }
+        break;
+    case 1: // vertical
+        if(e->page++>=e->page_end) {
+            e->page=e->page_start;
+            if(e->col++>=e->col_end)
+                e->col=e->col_start;
+        }
+        break;
+    default: // page: the column wraps, the page stays
+        e->col=(e->col+1)&0x7F;
+        break;
+    }
+}
+
+void ssd1306_emu_init(ssd1306_emu_t *e, uint8_t width, uint8_t height) {
+    memset(e, 0, sizeof(*e));
+    e->width=width;
+    e->height=height;
+    e->mode=2;	// reset state of the controller
+    e->col_end=127;
+    e->page_end=7;
+    e->contrast=0x7F;
+    e->mux=63;
+    e->control=0xFF;
+}
+
+void ssd1306_emu_begin(ssd1306_emu_t *e) {
+    e->open=true;
+    e->control=0xFF;
+    e->single=false;
+    ++e->frame.transactions;
+    e->frame.clocks+=1+9; // start, address and ack
+}
+
+void ssd1306_emu_bytes(ssd1306_emu_t *e, const uint8_t *bytes, size_t len) {
+    e->frame.bytes+=len;
+    e->frame.clocks+=9*(uint64_t) len;
+
+    for(size_t i=0; i<len; ++i) {
+        const uint8_t b=bytes[i];
+
+        if(e->control==0xFF || e->single) {
+            // control byte: Co (bit 7) says only one byte follows, D/C# (bit 6) data or commands
+            ++e->frame.control_bytes;
+            e->control=b&0xC0;
+            e->single=false;
+            if(b&0x80) {
+                e->single=true;
+                e->control|=0x3F; // not 0xFF, so the next byte is payload
+            }
+            continue;
+        }
+
+        if(e->control&0x40)
+            ssd1306_emu_data_byte(e, b);
+        else
+            ssd1306_emu_cmd_byte(e, b);
+
+        if(e->control&0x80)
+            e->control=0xFF; // Co set: a control byte comes next
+    }
+}
+
+void ssd1306_emu_end(ssd1306_emu_t *e) {
+    if(!e->open)
+        return;
+
+    e->open=false;
+    e->frame.clocks+=1; // stop
+}
+
+void ssd1306_emu_write(ssd1306_emu_t *e, const uint8_t *bytes, size_t len) {
+    ssd1306_emu_begin(e);
+    ssd1306_emu_bytes(e, bytes, len);
+    ssd1306_emu_end(e);
+}
+
+void ssd1306_emu_sink(void *emu, uint8_t control, const uint8_t *payload, size_t len) {
+    ssd1306_emu_t *e=emu;
+
+    ssd1306_emu_begin(e);
+    ssd1306_emu_bytes(e, &control, 1);
+    ssd1306_emu_bytes(e, payload, len);
+    ssd1306_emu_end(e);
+}
+
+void ssd1306_emu_end_frame(ssd1306_emu_t *e, ssd1306_emu_counts_t *frame) {
+    ssd1306_emu_counts_t *t=&e->total;
+    const ssd1306_emu_counts_t *f=&e->frame;
+
+    t->transactions+=f->transactions;
+    t->bytes+=f->bytes;
+    t->control_bytes+=f->control_bytes;
+    t->cmd_bytes+=f->cmd_bytes;
+    t->data_bytes+=f->data_bytes;
+    t->redundant_bytes+=f->redundant_bytes;
+    t->clocks+=f->clocks;
+
+    if(frame)
+        *frame=*f;
+    memset(&e->frame, 0, sizeof(e->frame));
+}
+
+double ssd1306_emu_bus_us(const ssd1306_emu_counts_t *c, uint32_t hz) {
+    // bus free time between a stop and the next start, standard / fast / fast plus mode
+    const double t_buf=hz<=100000?4.7:hz<=400000?1.3:0.5;
+
+    return (double) c->clocks*1e6/hz+c->transactions*t_buf;
+}
+
+bool ssd1306_emu_pixel(const ssd1306_emu_t *e, uint32_t x, uint32_t y) {
+    if(x>=e->width || y>=e->height || !e->display_on)
+        return false;
+
+    // the init sequence remaps both, which shows the picture upright on the usual modules
+    const uint32_t col_offset=(128-e->width)/2;
+    const uint32_t col=(e->seg_remap?x:e->width-1-x)+col_offset;
+    const uint32_t com=e->com_remap?y:e->height-1-y;
+    const uint32_t row=(com+e->start_line+e->offset)&63;
+
+    bool on=e->entire_on || (e->ram[row>>3][col]>>(row&7)&1);
+    return on!=e->invert;
+}
+
+void ssd1306_emu_print(FILE *f, const char *label, const ssd1306_emu_counts_t *c) {
+    static const uint32_t speeds[]=SSD1306_EMU_SPEEDS;
+
+    fprintf(f, "%-24s %4u tx %6u bytes (%u cmd, %u data, %u redundant)", label,
+            c->transactions, c->bytes, c->cmd_bytes, c->data_bytes, c->redundant_bytes);
+    for(size_t i=0; i<sizeof(speeds)/sizeof(speeds[0]); ++i)
+        fprintf(f, "  %8.0f us @%4u kHz", ssd1306_emu_bus_us(c, speeds[i]), speeds[i]/1000);
+    fputc('\n', f);
+}
+
+void ssd1306_emu_write_pbm(const ssd1306_emu_t *e, FILE *f) {
+    fprintf(f, "P1\n%u %u\n", e->width, e->height);
+    for(uint32_t y=0; y<e->height; ++y) {
+        for(uint32_t x=0; x<e->width; ++x)
+            fputc(ssd1306_emu_pixel(e, x, y)?'1':'0', f);
+        fputc('\n', f);
+    }
+}
@@ -0,0 +1,177 @@
+/**
+* @file ssd1306_emu.h
+*
+* host emulator of an ssd1306 on i2c: parses the bytes of each i2c write
+* (control bytes, commands with their arguments, gddram data in every
+* addressing mode), keeps the display ram and the panel state, and counts
+* bytes, transactions and the time they take on the bus.
+*
+* bus time is modeled per write: start, address byte, payload bytes, stop,
+* 9 clocks per byte (8 bits and the ack), one clock each for start and
+* stop, plus the bus free time before the next start.
+*/
+
+#ifndef _inc_ssd1306_emu
+#define _inc_ssd1306_emu
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief bus speeds reported by ssd1306_emu_print
+*/
+#define SSD1306_EMU_SPEEDS {100000, 400000, 1000000}
+
+/**
+*	@brief traffic counters, for a frame or since the start
+*/
+typedef struct {
+    uint32_t transactions;	/**< i2c writes */
+    uint32_t bytes;			/**< payload bytes, control bytes included, address bytes not */
+    uint32_t control_bytes;	/**< control bytes */
+    uint32_t cmd_bytes;		/**< command bytes, arguments included */
+    uint32_t data_bytes;	/**< gddram bytes */
+    uint32_t redundant_bytes;	/**< gddram bytes that did not change the ram */
+    uint64_t clocks;		/**< scl clocks, start and stop included */
+} ssd1306_emu_counts_t;
+
+/**
+*	@brief emulated display
+*/
+typedef struct {
+    uint8_t width;			/**< panel columns, 128 or 64 (centered in the ram) */
+    uint8_t height;			/**< panel rows */
+    uint8_t ram[8][128];	/**< gddram, page after page */
+
+    uint8_t mode;			/**< addressing mode: 0 horizontal, 1 vertical, 2 page */
+    uint8_t col, page;		/**< gddram pointer */
+    uint8_t col_start, col_end;	/**< column window */
+    uint8_t page_start, page_end;	/**< page window */
+
+    bool display_on;		/**< 0xAF */
+    bool invert;			/**< 0xA7 */
+    bool entire_on;			/**< 0xA5 */
+    bool seg_remap;			/**< 0xA1 */
+    bool com_remap;			/**< 0xC8 */
+    bool charge_pump;		/**< 0x8D 0x14 */
+    bool scrolling;			/**< 0x2F until 0x2E */
+    uint8_t contrast;		/**< 0x81 */
+    uint8_t start_line;		/**< 0x40-0x7F */
+    uint8_t offset;			/**< 0xD3 */
+    uint8_t mux;			/**< 0xA8, rows driven minus one */
+
+    uint8_t cmd[8];			/**< command being collected */
+    uint8_t cmd_len;		/**< bytes in cmd */
+    uint8_t cmd_need;		/**< bytes cmd needs in total */
+    uint8_t control;		/**< control byte in effect, 0xFF before the first one */
+    bool single;			/**< control byte had Co set: one byte, then another control byte */
+    bool open;				/**< inside a write */
+
+    uint32_t unknown_cmds;	/**< command bytes not understood */
+    uint32_t scroll_writes;	/**< gddram bytes written while scrolling, which the datasheet forbids */
+    ssd1306_emu_counts_t total;	/**< since ssd1306_emu_init */
+    ssd1306_emu_counts_t frame;	/**< since the last ssd1306_emu_end_frame */
+} ssd1306_emu_t;
+
+/**
+*	@brief set up an emulated display, as after power on
+*
+*	@param[out] e : emulator
+*	@param[in] width : panel columns, 128 or 64
+*	@param[in] height : panel rows, 32 or 64
+*/
+void ssd1306_emu_init(ssd1306_emu_t *e, uint8_t width, uint8_t height);
+
+/**
+*	@brief start an i2c write to the display (start condition and address)
+*/
+void ssd1306_emu_begin(ssd1306_emu_t *e);
+
+/**
+*	@brief feed bytes of the write in progress
+*/
+void ssd1306_emu_bytes(ssd1306_emu_t *e, const uint8_t *bytes, size_t len);
+
+/**
+*	@brief end the write in progress (stop condition)
+*/
+void ssd1306_emu_end(ssd1306_emu_t *e);
+
+/**
+*	@brief one whole i2c write, the bytes after the address
+*
+*	@param[in] e : emulator
+*	@param[in] bytes : control bytes and payload, as on the wire
+*	@param[in] len : number of bytes
+*/
+void ssd1306_emu_write(ssd1306_emu_t *e, const uint8_t *bytes, size_t len);
+
+/**
+*	@brief sink for the mock transport, see ssd1306_mock_set_sink
+*
+*	@param[in] emu : emulator
+*	@param[in] control : control byte of the write
+*	@param[in] payload : bytes after the control byte
+*	@param[in] len : number of payload bytes
+*/
+void ssd1306_emu_sink(void *emu, uint8_t control, const uint8_t *payload, size_t len);
+
+/**
+*	@brief close the current frame
+*
+*	@param[in] e : emulator
+*	@param[out] frame : counters of the frame, may be NULL
+*/
+void ssd1306_emu_end_frame(ssd1306_emu_t *e, ssd1306_emu_counts_t *frame);
+
+/**
+*	@brief modeled bus time
+*
+*	@param[in] c : counters
+*	@param[in] hz : scl frequency
+*
+*	@return time in microseconds
+*/
+double ssd1306_emu_bus_us(const ssd1306_emu_counts_t *c, uint32_t hz);
+
+/**
+*	@brief pixel as seen on the panel
+*
+*	follows segment and com remap, start line, display offset, inversion,
+*	entire display on and display off.
+*
+*	@param[in] e : emulator
+*	@param[in] x : column of the panel
+*	@param[in] y : row of the panel
+*
+*	@return true if the pixel is lit
+*/
+bool ssd1306_emu_pixel(const ssd1306_emu_t *e, uint32_t x, uint32_t y);
+
+/**
+*	@brief print counters and modeled bus time at 100 kHz, 400 kHz and 1 MHz
+*
+*	@param[in] f : output
+*	@param[in] label : name of the line
+*	@param[in] c : counters
+*/
+void ssd1306_emu_print(FILE *f, const char *label, const ssd1306_emu_counts_t *c);
+
+/**
+*	@brief write the panel as a plain pbm image
+*
+*	@param[in] e : emulator
+*	@param[in] f : output
+*/
+void ssd1306_emu_write_pbm(const ssd1306_emu_t *e, FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
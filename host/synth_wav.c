@@ -0,0 +1,133 @@
+/**
+* @file synth_wav.c
+*
+* renders notes through the buzzer synth (sintetizador.c, the same code
+* the firmware runs from the dma interrupt) into a 16 bit mono wav file,
+* to listen to a melody or check the mix without the board.
+*
+* usage: synth_wav out.wav [-w square|triangle|sine] note...
+*   note is freq:ms, freq+freq:ms for both voices, 0:ms for a rest
+*   e.g. the success tune:
+*   synth_wav ok.wav 622:125 698:125 370:125 698:125 370:125 415:125 \
+*                    370:125 415:125 466:125 415:125 466:125 466:125
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sintetizador.h"
+
+static FILE *out;
+static uint32_t written, peak;
+
+static void put_le(uint32_t v, int bytes) {
+    for(int i=0; i<bytes; ++i)
+        fputc(v>>(8*i)&0xff, out);
+}
+
+static void write_header(uint32_t samples) {
+    fwrite("RIFF", 1, 4, out);
+    put_le(36+samples*2, 4);
+    fwrite("WAVEfmt ", 1, 8, out);
+    put_le(16, 4);
+    put_le(1, 2);                       // pcm
+    put_le(1, 2);                       // mono
+    put_le(SINTETIZADOR_TAXA, 4);
+    put_le(SINTETIZADOR_TAXA*2, 4);
+    put_le(2, 2);
+    put_le(16, 2);
+    fwrite("data", 1, 4, out);
+    put_le(samples*2, 4);
+}
+
+// renders in blocks of the firmware's size and writes them as signed samples
+static void render(uint32_t samples) {
+    uint16_t block[SINTETIZADOR_BLOCO];
+
+    while(samples) {
+        const uint32_t n=samples<SINTETIZADOR_BLOCO?samples:SINTETIZADOR_BLOCO;
+
+        sintetizador_gerar(block, n);
+        for(uint32_t i=0; i<n; ++i) {
+            const int32_t s=((int32_t) block[i]-SINTETIZADOR_SILENCIO)*256;
+            const uint32_t a=s<0?-s:s;
+            if(a>peak)
+                peak=a;
+            put_le((uint16_t) s, 2);
+        }
+        written+=n;
+        samples-=n;
+    }
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: synth_wav out.wav [-w square|triangle|sine] freq[+freq]:ms...\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    static const char *const names[NUM_ONDAS]= {"square", "triangle", "sine"};
+    static const envelope_t envelope=SINTETIZADOR_ENVELOPE_PADRAO;
+    onda_t wave=ONDA_TRIANGULAR;
+    int first=2;
+
+    if(argc<3)
+        return usage();
+
+    if(!strcmp(argv[2], "-w")) {
+        if(argc<5)
+            return usage();
+        for(wave=0; wave<NUM_ONDAS && strcmp(argv[3], names[wave]); ++wave)
+            ;
+        if(wave==NUM_ONDAS)
+            return usage();
+        first=4;
+    }
+
+    out=fopen(argv[1], "wb");
+    if(!out) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    sintetizador_init(SINTETIZADOR_TAXA);
+    write_header(0);
+
+    // same timing as the sequencer: each note starts when the previous one's time is up
+    for(int i=first; i<argc; ++i) {
+        unsigned f1=0, f2=0, ms=0;
+
+        if(sscanf(argv[i], "%u+%u:%u", &f1, &f2, &ms)!=3) {
+            f2=0;
+            if(sscanf(argv[i], "%u:%u", &f1, &ms)!=2) {
+                fprintf(stderr, "synth_wav: bad note '%s'\n", argv[i]);
+                fclose(out);
+                return 2;
+            }
+        }
+
+        if(f1)
+            sintetizador_nota(0, f1, ms, wave, &envelope);
+        else
+            sintetizador_soltar(0);
+        if(f2)
+            sintetizador_nota(1, f2, ms, wave, &envelope);
+        else
+            sintetizador_soltar(1);
+
+        render((uint64_t) ms*SINTETIZADOR_TAXA/1000);
+    }
+
+    // let the last release ring out
+    while(sintetizador_tocando())
+        render(SINTETIZADOR_BLOCO);
+
+    fseek(out, 0, SEEK_SET);
+    write_header(written);
+    fclose(out);
+
+    printf("%s: %u samples, %.3f s at %u Hz, peak %.1f%% of full scale\n", argv[1], (unsigned) written,
+           (double) written/SINTETIZADOR_TAXA, (unsigned) SINTETIZADOR_TAXA, 100.0*peak/32768);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file leds.c
+ * @brief Efeitos dos LEDs, atualizados por timer repetitivo
+ * @author Andre de Oliveira Melo
+ */
+
+ #include <math.h>
+ #include "pico/stdlib.h"
+ #include "hardware/pwm.h"
+ #include "hardware/sync.h"
+ #include "leds.h"
+
+ #define LEDS_GAMA 2.2f      // Expoente da correção de brilho
+
+ typedef struct {
+     led_efeito_t efeito;    // Efeito tocando
+     uint32_t inicio_ms;     // Quando ele começou
+     uint16_t nivel;         // Último nível PWM escrito
+     bool ativo;             // false: apagado
+     bool na_base;           // Tocando o efeito base, não um roteiro
+ } estado_led_t;
+
+ static uint pinos[NUM_LEDS];
+ static uint16_t gama[256];
+ static estado_led_t estados[NUM_LEDS];
+ static led_efeito_t bases[NUM_LEDS];
+ static bool tem_base[NUM_LEDS];
+ static repeating_timer_t timer;
+ static volatile bool rodando = false;
+
+ static uint32_t agora_ms(void) {
+     return to_ms_since_boot(get_absolute_time());
+ }
+
+ /**
+  * @brief Brilho perceptivo de um efeito, t ms depois do começo
+  */
+ static uint8_t brilho(const led_efeito_t *e, uint32_t t) {
+     const int32_t faixa = (int32_t) e->ate - e->de;
+     const uint32_t periodo = e->periodo_ms ? e->periodo_ms : 1;
+     const uint32_t fase = t % periodo;
+
+     switch (e->tipo) {
+         case LED_FADE:
+             if (!e->duracao_ms || t >= e->duracao_ms) {
+                 return e->ate;
+             }
+             return e->de + faixa * (int32_t) t / e->duracao_ms;
+         case LED_RESPIRAR: {
+             // Triângulo no brilho perceptivo; a gama deixa a subida suave
+             const uint32_t meio = periodo / 2 ? periodo / 2 : 1;
+             const uint32_t x = fase < meio ? fase * 255 / meio : (periodo - fase) * 255 / (periodo - meio);
+             return e->de + faixa * (int32_t) x / 255;
+         }
+         case LED_PULSAR:
+             return fase < periodo / 2 ? e->ate : e->de;
+         default:
+             return e->ate;
+     }
+ }
+
+ /**
+  * @brief Informa se o efeito ainda precisa do timer
+  */
+ static bool animado(const estado_led_t *s) {
+     return s->ativo && (s->efeito.tipo != LED_FIXO || s->efeito.duracao_ms);
+ }
+
+ /**
+  * @brief Passa para a base do LED, ou apaga se ele não tiver uma
+  */
+ static void voltar_base(led_t led) {
+     estados[led].ativo = tem_base[led];
+     estados[led].na_base = true;
+     estados[led].efeito = bases[led];
+ }
+
+ /**
+  * @brief Encadeia os efeitos vencidos e escreve o brilho de agora
+  *
+  * Chamada pelo timer ou com as interrupções desligadas.
+  *
+  * @return true se o LED ainda está animando
+  */
+ static bool atualizar(led_t led, uint32_t agora) {
+     estado_led_t *s = &estados[led];
+     uint32_t t = agora - s->inicio_ms;
+
+     while (s->ativo && s->efeito.duracao_ms && t >= s->efeito.duracao_ms) {
+         const led_efeito_t *proximo = s->efeito.proximo;
+
+         s->inicio_ms += s->efeito.duracao_ms;
+         t -= s->efeito.duracao_ms;
+         if (proximo) {
+             s->efeito = *proximo;
+         } else {
+             voltar_base(led);
+         }
+     }
+
+     uint16_t nivel = s->ativo ? gama[brilho(&s->efeito, t)] : 0;
+     if (nivel != s->nivel) {
+         pwm_set_gpio_level(pinos[led], nivel);
+         s->nivel = nivel;
+     }
+
+     return animado(s);
+ }
+
+ static bool passo(repeating_timer_t *rt) {
+     const uint32_t agora = agora_ms();
+     bool algum = false;
+
+     for (int i = 0; i < NUM_LEDS; i++) {
+         algum |= atualizar(i, agora);
+     }
+
+     // Tudo parado: o timer some até o próximo efeito animado
+     rodando = algum;
+     return algum;
+ }
+
+ /**
+  * @brief Escreve o LED agora e liga o timer se ele for animar
+  */
+ static void comecar(led_t led) {
+     if (atualizar(led, estados[led].inicio_ms) && !rodando) {
+         rodando = add_repeating_timer_ms(-LEDS_PASSO_MS, passo, NULL, &timer);
+     }
+ }
+
+ void leds_init(uint pino_verde, uint pino_vermelho, uint16_t nivel_max) {
+     pinos[LED_VERDE] = pino_verde;
+     pinos[LED_VERMELHO] = pino_vermelho;
+
+     for (int i = 0; i < 256; i++) {
+         gama[i] = (uint16_t) lroundf(nivel_max * powf(i / 255.0f, LEDS_GAMA));
+     }
+
+     for (int i = 0; i < NUM_LEDS; i++) {
+         tem_base[i] = false;
+         estados[i].ativo = false;
+         estados[i].nivel = 0;
+         pwm_set_gpio_level(pinos[i], 0);
+     }
+ }
+
+ void leds_base(led_t led, const led_efeito_t *efeito) {
+     uint32_t estado = save_and_disable_interrupts();
+
+     tem_base[led] = efeito != NULL;
+     if (efeito) {
+         bases[led] = *efeito;
+     }
+
+     // Um roteiro em andamento termina antes; a base nova entra no fim dele
+     if (estados[led].na_base || !estados[led].ativo) {
+         voltar_base(led);
+         estados[led].inicio_ms = agora_ms();
+         comecar(led);
+     }
+
+     restore_interrupts(estado);
+ }
+
+ void leds_efeito(led_t led, const led_efeito_t *efeito) {
+     uint32_t estado = save_and_disable_interrupts();
+
+     estados[led].efeito = *efeito;
+     estados[led].ativo = true;
+     estados[led].na_base = false;
+     estados[led].inicio_ms = agora_ms();
+     comecar(led);
+
+     restore_interrupts(estado);
+ }
+
+ void leds_piscar(led_t led, uint16_t duracao_ms) {
+     const led_efeito_t piscada = {LED_FIXO, 0, 255, 0, duracao_ms, NULL};
+
+     leds_efeito(led, &piscada);
+ }
@@ -0,0 +1,89 @@
+/**
+ * @file leds.h
+ * @brief Efeitos dos LEDs (respirar, piscar, pulsar, fades) em segundo plano
+ * @author Andre de Oliveira Melo
+ *
+ * Cada LED toca um efeito; quando um efeito com duração acaba, entra o
+ * próximo do encadeamento ou, no fim dele, o efeito base do LED. Assim a
+ * aplicação monta roteiros com tabelas const e só troca de efeito nas
+ * mudanças de estado. O brilho é perceptivo (0 a 255) e passa por uma
+ * tabela de gama antes de ir para o PWM, num timer repetitivo que para
+ * sozinho quando nada está animando.
+ */
+
+ #ifndef LEDS_H
+ #define LEDS_H
+
+ #include "pico/stdlib.h"
+
+ #define LEDS_PASSO_MS 10    // Intervalo entre atualizações do brilho
+
+ /**
+  * @brief LEDs controlados
+  */
+ typedef enum {
+     LED_VERDE,
+     LED_VERMELHO,
+     NUM_LEDS
+ } led_t;
+
+ /**
+  * @brief Tipos de efeito
+  */
+ typedef enum {
+     LED_FIXO,       // Brilho 'ate' o tempo todo
+     LED_FADE,       // De 'de' a 'ate' ao longo da duração
+     LED_RESPIRAR,   // Sobe e desce entre 'de' e 'ate' a cada período
+     LED_PULSAR      // 'ate' na primeira metade do período, 'de' na segunda
+ } led_efeito_tipo_t;
+
+ /**
+  * @brief Um efeito e o que vem depois dele
+  */
+ typedef struct led_efeito {
+     led_efeito_tipo_t tipo;
+     uint8_t de;                         // Brilho perceptivo inicial ou mínimo
+     uint8_t ate;                        // Brilho perceptivo final ou máximo
+     uint16_t periodo_ms;                // Período de respirar e pulsar
+     uint16_t duracao_ms;                // 0 para sem fim
+     const struct led_efeito *proximo;   // Depois da duração; NULL volta à base
+ } led_efeito_t;
+
+ /**
+  * @brief Prepara a tabela de gama e apaga os LEDs
+  *
+  * Os pinos já devem estar configurados como saída PWM.
+  *
+  * @param pino_verde Pino do LED verde
+  * @param pino_vermelho Pino do LED vermelho
+  * @param nivel_max Nível PWM do brilho 255
+  */
+ void leds_init(uint pino_verde, uint pino_vermelho, uint16_t nivel_max);
+
+ /**
+  * @brief Define o efeito base de um LED, tocado quando um roteiro termina
+  *
+  * @param led LED
+  * @param efeito Efeito base, NULL para apagado; é copiado
+  */
+ void leds_base(led_t led, const led_efeito_t *efeito);
+
+ /**
+  * @brief Começa um efeito num LED agora, no lugar do que estiver tocando
+  *
+  * Pode ser chamada de interrupções (alarmes da melodia, GPIO).
+  *
+  * @param led LED
+  * @param efeito Efeito, copiado; o encadeamento deve continuar existindo
+  */
+ void leds_efeito(led_t led, const led_efeito_t *efeito);
+
+ /**
+  * @brief Acende um LED no brilho máximo por um tempo e volta à base
+  *
+  * @param led LED
+  * @param duracao_ms Tempo aceso
+  */
+ void leds_piscar(led_t led, uint16_t duracao_ms);
+
+ #endif
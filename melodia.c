@@ -0,0 +1,203 @@
+/**
+ * @file melodia.c
+ * @brief Sequenciador de melodias no buzzer, tocado por alarme de hardware
+ * @author Andre de Oliveira Melo
+ */
+
+ #include "pico/stdlib.h"
+ #include "hardware/pwm.h"
+ #include "hardware/clocks.h"
+ #include "hardware/sync.h"
+ #include "melodia.h"
+ #ifdef SINTETIZADOR
+ #include "sintetizador.h"
+ #endif
+
+ #define MELODIA_WRAP 4095              // Contagem do PWM por período do tom
+ #define MELODIA_NIVEL_TOM 2048         // 50% de ciclo de trabalho
+ #define MELODIA_ANTES_DA_PRIMEIRA 0xFF // Índice de nota antes de avancar()
+
+ static uint buzzer;
+
+ // Fila circular; a melodia tocando é fila[inicio]
+ static const melodia_t *fila[MELODIA_FILA];
+ static uint8_t inicio = 0;
+ static volatile uint8_t quantidade = 0;
+ static uint8_t nota = 0;               // Nota tocando em fila[inicio]
+ static alarm_id_t alarme = 0;          // 0 quando não há alarme agendado
+
+ #ifdef SINTETIZADOR
+ static bool sintetizado = false;       // Buzzer no sintetizador, não em onda quadrada
+ static const envelope_t envelope = SINTETIZADOR_ENVELOPE_PADRAO;
+ #endif
+
+ /**
+  * @brief Programa o PWM do buzzer para uma nota e acende os LEDs dela
+  */
+ static void tocar_nota(const nota_t *n) {
+ #ifdef SINTETIZADOR
+     if (sintetizado) {
+         if (n->frequencia) {
+             sintetizador_nota(0, n->frequencia, n->duracao_ms, ONDA_TRIANGULAR, &envelope);
+         } else {
+             sintetizador_soltar(0);
+         }
+     } else
+ #endif
+     if (n->frequencia) {
+         // Divisor fracionário, limitado à faixa do hardware, para a nota sair afinada
+         uint slice = pwm_gpio_to_slice_num(buzzer);
+         float divisor = (float) clock_get_hz(clk_sys) / ((float) n->frequencia * (MELODIA_WRAP + 1));
+         if (divisor < 1.0f) {
+             divisor = 1.0f;
+         } else if (divisor > 255.9f) {
+             divisor = 255.9f;
+         }
+         pwm_set_clkdiv(slice, divisor);
+         pwm_set_wrap(slice, MELODIA_WRAP);
+         pwm_set_gpio_level(buzzer, MELODIA_NIVEL_TOM);
+         pwm_set_enabled(slice, true);
+     } else {
+         pwm_set_gpio_level(buzzer, 0);
+     }
+
+     // Cada LED da nota fica aceso enquanto ela dura e depois volta ao seu efeito base
+     for (int led = 0; led < NUM_LEDS; led++) {
+         if (n->leds & (1 << led)) {
+             leds_piscar(led, n->duracao_ms);
+         }
+     }
+ }
+
+ /**
+  * @brief Desliga o buzzer; os LEDs da última nota apagam sozinhos
+  */
+ static void silenciar(void) {
+ #ifdef SINTETIZADOR
+     if (sintetizado) {
+         sintetizador_soltar(0);
+     } else
+ #endif
+     pwm_set_gpio_level(buzzer, 0);
+ }
+
+ /**
+  * @brief Passa para a próxima nota, da mesma melodia ou da próxima da fila
+  *
+  * @return Duração da nota em us, 0 se a fila acabou
+  */
+ static int64_t avancar(void) {
+     nota++;
+
+     while (quantidade) {
+         const melodia_t *m = fila[inicio];
+
+         if (nota < m->num_notas) {
+             tocar_nota(&m->notas[nota]);
+             return (int64_t) m->notas[nota].duracao_ms * 1000;
+         }
+
+         // Melodia terminou, a próxima da fila começa sem intervalo
+         inicio = (inicio + 1) % MELODIA_FILA;
+         quantidade--;
+         nota = 0;
+     }
+
+     silenciar();
+     return 0;
+ }
+
+ /**
+  * @brief Callback do alarme, no fim de cada nota (contexto de interrupção)
+  *
+  * Um valor negativo reagenda o alarme a partir do horário em que ele
+  * deveria ter disparado, então as notas não acumulam atraso.
+  */
+ static int64_t proxima_nota(alarm_id_t id, void *dados) {
+     int64_t duracao = avancar();
+
+     if (!duracao) {
+         alarme = 0;
+     }
+     return -duracao;
+ }
+
+ /**
+  * @brief Começa a primeira melodia da fila; chamada com interrupções desligadas
+  */
+ static void iniciar(void) {
+     nota = MELODIA_ANTES_DA_PRIMEIRA;
+     int64_t duracao = avancar();
+
+     if (duracao) {
+         alarme = add_alarm_in_us(duracao, proxima_nota, NULL, true);
+         if (alarme <= 0) {
+             // Sem alarme livre: melhor não tocar do que travar numa nota
+             alarme = 0;
+             quantidade = 0;
+             silenciar();
+         }
+     }
+ }
+
+ /**
+  * @brief Cancela o alarme agendado, se houver; chamada com interrupções desligadas
+  */
+ static void cancelar(void) {
+     if (alarme > 0) {
+         cancel_alarm(alarme);
+         alarme = 0;
+     }
+ }
+
+ void melodia_init(uint pino_buzzer) {
+     buzzer = pino_buzzer;
+     quantidade = 0;
+     alarme = 0;
+ #ifdef SINTETIZADOR
+     // Sem DMA livre, as melodias continuam em onda quadrada
+     sintetizado = sintetizador_iniciar_saida(pino_buzzer);
+ #endif
+ }
+
+ void melodia_tocar(const melodia_t *m) {
+     uint32_t estado = save_and_disable_interrupts();
+
+     cancelar();
+     fila[0] = m;
+     inicio = 0;
+     quantidade = 1;
+     iniciar();
+
+     restore_interrupts(estado);
+ }
+
+ bool melodia_enfileirar(const melodia_t *m) {
+     uint32_t estado = save_and_disable_interrupts();
+     bool cabe = quantidade < MELODIA_FILA;
+
+     if (cabe) {
+         fila[(inicio + quantidade) % MELODIA_FILA] = m;
+         quantidade++;
+         if (quantidade == 1) {
+             iniciar();  // Fila estava parada
+         }
+     }
+
+     restore_interrupts(estado);
+     return cabe;
+ }
+
+ void melodia_parar(void) {
+     uint32_t estado = save_and_disable_interrupts();
+
+     cancelar();
+     quantidade = 0;
+     silenciar();
+
+     restore_interrupts(estado);
+ }
+
+ bool melodia_tocando(void) {
+     return quantidade > 0;
+ }
@@ -0,0 +1,93 @@
+/**
+ * @file melodia.h
+ * @brief Sequenciador de melodias no buzzer, tocado por alarme de hardware
+ * @author Andre de Oliveira Melo
+ *
+ * Cada nota é programada no PWM do buzzer pelo callback de um alarme,
+ * que se reagenda para o fim da nota. Nada bloqueia: o teclado e o
+ * display seguem funcionando enquanto a melodia toca. Cada nota também
+ * diz quais LEDs piscam durante ela (leds.h).
+ *
+ * Compilado com SINTETIZADOR, as notas saem pelo sintetizador de tabela
+ * de onda (sintetizador.h) em vez da onda quadrada do PWM.
+ */
+
+ #ifndef MELODIA_H
+ #define MELODIA_H
+
+ #include "pico/stdlib.h"
+ #include "leds.h"
+
+ /**
+  * @defgroup MELODIA_LEDS LEDs acesos durante uma nota
+  * @{
+  */
+ #define MELODIA_LED_VERDE (1 << LED_VERDE)
+ #define MELODIA_LED_VERMELHO (1 << LED_VERMELHO)
+ /**
+  * @}
+  */
+
+ /**
+  * @brief Melodias que podem esperar na fila atrás da que está tocando
+  */
+ #define MELODIA_FILA 4
+
+ /**
+  * @brief Uma nota da melodia
+  */
+ typedef struct {
+     uint16_t frequencia;  // Hz, 0 para pausa
+     uint16_t duracao_ms;  // Duração da nota
+     uint8_t leds;         // MELODIA_LED_* acesos durante a nota
+ } nota_t;
+
+ /**
+  * @brief Tabela de notas, normalmente const na flash
+  */
+ typedef struct {
+     const nota_t *notas;
+     uint8_t num_notas;
+ } melodia_t;
+
+ /**
+  * @brief Define a melodia de uma tabela de notas
+  */
+ #define MELODIA(tabela) {(tabela), sizeof(tabela) / sizeof((tabela)[0])}
+
+ /**
+  * @brief Prepara o sequenciador
+  *
+  * O pino já deve estar configurado como saída PWM, e os LEDs das notas
+  * com leds_init.
+  *
+  * @param pino_buzzer Pino do buzzer
+  */
+ void melodia_init(uint pino_buzzer);
+
+ /**
+  * @brief Toca uma melodia agora, interrompendo a atual e esvaziando a fila
+  *
+  * @param m Melodia, deve existir até terminar de tocar
+  */
+ void melodia_tocar(const melodia_t *m);
+
+ /**
+  * @brief Toca uma melodia depois das que já estão tocando ou na fila
+  *
+  * @param m Melodia, deve existir até terminar de tocar
+  * @return false se a fila estiver cheia
+  */
+ bool melodia_enfileirar(const melodia_t *m);
+
+ /**
+  * @brief Para a melodia atual e esvazia a fila; o buzzer cala
+  */
+ void melodia_parar(void);
+
+ /**
+  * @brief Informa se ainda há melodia tocando ou na fila
+  */
+ bool melodia_tocando(void);
+
+ #endif
@@ -13,11 +13,29 @@
  #include "pico/stdlib.h"        // Biblioteca padrão do Pico
  #include "hardware/timer.h"     // Para usar o timer/alarm
  #include "ssd1306/ssd1306.h"    // Para usar o display OLED
+ #include "ssd1306/transitions.h" // Fades e rolagens feitos pelo display
+ #include "ssd1306/tilemap.h"    // Campo da senha em blocos de 8x8
+ #include "ssd1306/frame.h"      // Um envio por quadro
+ #include "telas.h"              // Telas fixas compiladas de assets/telas
+ #ifdef DISPLAY_CINZA
+ #include "ssd1306/gray.h"       // Níveis de cinza por alternância de planos
+ #endif
+ #ifdef SSD1306_CAPTURE
+ #include "ssd1306/capture.h"    // Cópia dos quadros do display pelo USB
+ #endif
  #include "hardware/i2c.h"       // Para comunicação I2C
+ #include "hardware/spi.h"       // Para displays SPI
  #include "hardware/adc.h"       // Para leitura do joystick via ADC
  #include "pico/rand.h"          // Para geração de números aleatórios
  #include "hardware/pwm.h"       // Para controle PWM (LEDs e buzzer)
  #include "hardware/clocks.h"    // Para configuração de clock
+ #include "leds.h"               // Efeitos dos LEDs em segundo plano
+ #include "melodia.h"            // Melodias do buzzer tocadas por alarme
+ #include "agenda.h"             // Tarefas do loop principal
+ #include "eventos.h"            // Fila de eventos de entrada
+ #ifdef SRK_BENCHMARK
+ #include "benchmark.h"          // Medições de desempenho do display
+ #endif
  
  /** 
   * @defgroup PINS Definições de Pinos
@@ -33,6 +51,77 @@
   * @}
   */
  
+ /** 
+  * @defgroup DISPLAY_CONFIG Barramento do display
+  * 
+  * Por padrão o display é I2C. Defina DISPLAY_SPI para usar um módulo
+  * SSD1306 SPI de 4 fios, bem mais rápido.
+  * @{
+  */
+ #define DISPLAY_I2C_SDA 14
+ #define DISPLAY_I2C_SCL 15
+ #define DISPLAY_I2C_FREQ 400000     // 400kHz
+ #define DISPLAY_I2C_ADDR 0x3C
+ #define DISPLAY_SPI_SCK 18
+ #define DISPLAY_SPI_MOSI 19
+ #define DISPLAY_SPI_CS 17
+ #define DISPLAY_SPI_DC 20
+ #define DISPLAY_SPI_RST 16
+ #define DISPLAY_SPI_FREQ 10000000   // 10MHz
+ #define DISPLAY_FALHAS_MAX 3        // Falhas seguidas até o driver desistir do display
+ #define DISPLAY_NOVA_TENTATIVA_MS 1000  // Intervalo entre tentativas de recuperar o display
+ #define DISPLAY_QUADROS_POR_SEGUNDO 10  // Taxa de quadros do que não é enviado na hora
+ /**
+  * @}
+  */
+ 
+ /** 
+  * @defgroup STATUS_CONFIG Tela de status do operador
+  * 
+  * Defina DISPLAY_STATUS para ligar um segundo SSD1306 no i2c0 com as
+  * tentativas, acertos e a saúde do display principal. Ele é enviado por
+  * DMA ao mesmo tempo que o display principal, que está no i2c1.
+  * @{
+  */
+ #define STATUS_I2C_SDA 0
+ #define STATUS_I2C_SCL 1
+ #define STATUS_I2C_ADDR 0x3C
+ /**
+  * @}
+  */
+ 
+ /** 
+  * @defgroup CINZA_CONFIG Linhas apagadas em cinza
+  * 
+  * Defina DISPLAY_CINZA para mostrar as linhas fora do cursor num cinza
+  * escuro, alternando planos de bits pelo DMA num timer. Cada plano vai
+  * numa janela em volta das linhas apagadas; a 400 kHz isso dá por volta
+  * de 170 planos por segundo, a taxa sustentada sai no USB a cada senha.
+  * @{
+  */
+ #define CINZA_PLANOS_POR_SEGUNDO 150   // Taxa do timer dos planos
+ #define CINZA_APAGADO 1                // Nível das linhas fora do cursor (0-3)
+ /**
+  * @}
+  */
+ 
+ /** 
+  * @defgroup TRANSICOES Transições de tela
+  * 
+  * Feitas pelo próprio controlador do display (contraste, linha inicial
+  * e scroll), sem reenviar o framebuffer.
+  * @{
+  */
+ #define CONTRASTE_MAX 0xFF
+ #define FADE_MS 300             // Duração do fade do resultado
+ #define ROLAGEM_MS 400          // Duração da rolagem do teclado novo
+ #define PAGINAS_RESULTADO 1     // Última página ocupada pelo texto do resultado
+ #define ABERTURA_MS 1500        // Tempo da tela de abertura
+ #define RESULTADO_MS 1000       // Tempo do resultado na tela; a melodia segue tocando depois
+ /**
+  * @}
+  */
+ 
  /** 
   * @defgroup ADC_CHANNELS Canais ADC 
   * @{
@@ -54,6 +143,18 @@
   * @}
   */
  
+ /** 
+  * @defgroup EFEITOS_LED Efeitos dos LEDs
+  * @{
+  */
+ #define PISCADA_MS 60           // LED verde a cada botão aceito
+ #define RESPIRACAO_MS 4000      // Período do verde respirando à espera
+ #define BRILHO_OCIOSO 96        // Brilho máximo do verde respirando (de 255)
+ #define PULSO_BLOQUEIO_MS 200   // Período do vermelho pulsando na senha errada
+ /**
+  * @}
+  */
+ 
  /** 
   * @defgroup KEYPAD_CONFIG Configuração do Teclado
   * @{
@@ -61,7 +162,53 @@
  #define NUM_LINES 4           // Número de linhas no teclado
  #define NUMBERS_PER_LINE 3    // Número de dígitos por linha
  #define PIN_LENGTH 6          // Tamanho da senha
- #define DEBOUNCE_TIME_MS 200  // Tempo de debounce em milissegundos
+ #define DEBOUNCE_TIME_MS 30   // Silêncio do botão antes de um aperto valer
+ #define JOYSTICK_MS 100       // Intervalo entre amostras do joystick (um passo de linha)
+ #define ENTRADA_LOTE 8        // Eventos retirados da fila de cada vez
+ /**
+  * @}
+  */
+ 
+ /** 
+  * @defgroup LAYOUT_CONFIG Layout do teclado no display
+  * @{
+  */
+ #ifndef KEYPAD_ESCALA
+ #define KEYPAD_ESCALA 1       // 1: fonte normal, 2: dígitos grandes
+ #endif
+ #define DIGITO_X 30           // Posição X do primeiro dígito de cada linha
+ #if KEYPAD_ESCALA == 2
+ #define DIGITO_PASSO 18       // Distância entre dígitos de uma linha
+ #else
+ #define DIGITO_PASSO 12
+ #endif
+ /**
+  * @}
+  */
+ 
+ /** 
+  * @defgroup CURSOR_CONFIG Configuração do cursor de seleção
+  * @{
+  */
+ #define CURSOR_X 20
+ #define CURSOR_WIDTH 3
+ #define CURSOR_HEIGHT 5
+ #define CURSOR_NENHUM 0xFF    // Cursor não desenhado
+ /**
+  * @}
+  */
+ 
+ /** 
+  * @defgroup SENHA_CONFIG Campo da senha
+  * 
+  * Os asteriscos ocupam blocos de 8x8 de um mapa de blocos, então cada
+  * dígito digitado envia só os 8 bytes do seu bloco.
+  * @{
+  */
+ #define SENHA_COLUNA 10       // Primeiro bloco do campo (x = 80)
+ #define SENHA_LINHA 3         // Linha de blocos do campo (y = 24)
+ #define BLOCO_VAZIO 0
+ #define BLOCO_ASTERISCO 1
  /**
   * @}
   */
@@ -71,14 +218,87 @@
   */
  ssd1306_t disp;
  
+ /**
+  * @brief Agendador de quadros do display
+  * 
+  * As funções de desenho só mexem no framebuffer; tudo o que mudou é
+  * enviado de uma vez no próximo quadro.
+  */
+ static ssd1306_frame_t quadro;
+ 
+ #ifdef SSD1306_CAPTURE
+ /**
+  * @brief Captura dos quadros do display principal
+  * 
+  * Cada envio sai pelo USB como a diferença para o quadro anterior;
+  * tools/ssd1306_capture.py monta os quadros de volta em PNG ou vídeo.
+  */
+ static ssd1306_capture_t captura;
+ #endif
+ 
+ #ifdef DISPLAY_CINZA
+ /**
+  * @brief Camada em tons de cinza do display principal
+  * 
+  * O teclado continua sendo desenhado no framebuffer de 1 bit; a cada
+  * quadro ele é copiado para os planos com as linhas apagadas em cinza.
+  */
+ static ssd1306_gray_t cinza;
+ #endif
+ 
+ #ifdef DISPLAY_STATUS
+ /**
+  * @brief Tela de status do operador
+  */
+ ssd1306_t tela_status;
+ static ssd1306_frame_t quadro_status;
+ 
+ static uint32_t tentativas = 0;  // Senhas verificadas
+ static uint32_t acertos = 0;     // Senhas corretas
+ #endif
+ 
+ /**
+  * @brief Displays ligados, recuperados um a um por verificar_display
+  */
+ static ssd1306_t *const telas[] = {
+     &disp,
+ #ifdef DISPLAY_STATUS
+     &tela_status,
+ #endif
+ };
+ #define NUM_TELAS (sizeof(telas) / sizeof(telas[0]))
+ 
  /**
   * @brief Variáveis globais do sistema
   */
- static volatile uint8_t linha_atual = 0;        // Linha selecionada atualmente
- static volatile bool button_pressed = false;    // Flag para botão pressionado
+ static uint8_t linha_atual = 0;                 // Linha selecionada atualmente
+ static bool bloqueado = true;                   // Abertura ou resultado na tela, entrada ignorada
  static uint8_t char_count = 0;                  // Contador de caracteres digitados
- static char senha_display[PIN_LENGTH + 1];      // String para exibir asteriscos da senha
- static absolute_time_t last_button_time = {0};  // Timestamp do último pressionamento de botão
+ static uint32_t ultima_borda_us = 0;            // Quando o botão mudou de estado pela última vez
+ static repeating_timer_t timer_joystick;        // Amostragem do joystick, em interrupção
+ static uint8_t linha_cursor = CURSOR_NENHUM;    // Linha onde o cursor está desenhado
+ #if KEYPAD_ESCALA == 2
+ static const uint8_t linha_y[NUM_LINES] = {0, 16, 32, 48};   // Posição Y dos dígitos por linha
+ static const uint8_t cursor_y[NUM_LINES] = {5, 21, 37, 53};  // Posição Y do cursor por linha
+ #else
+ static const uint8_t linha_y[NUM_LINES] = {5, 20, 35, 50};
+ static const uint8_t cursor_y[NUM_LINES] = {5, 20, 35, 50};
+ #endif
+ 
+ /**
+  * @brief Glifos prontos dos dígitos 0-9, um atlas por linha do teclado
+  * 
+  * Cada atlas já tem os dígitos deslocados para a posição Y da sua linha,
+  * então desenhar um dígito é só copiar bytes para o buffer do display.
+  */
+ static ssd1306_atlas_t atlas_digitos[NUM_LINES];
+ static uint8_t atlas_memoria[NUM_LINES][SSD1306_ATLAS_BYTES(10, 5, KEYPAD_ESCALA)];
+ 
+ /**
+  * @brief Mapa de blocos do campo da senha e seus blocos (vazio e asterisco)
+  */
+ static ssd1306_tilemap_t mapa_senha;
+ static uint8_t blocos_senha[2 * SSD1306_TILE_BYTES];
  
  /**
   * @brief Arrays para armazenamento das configurações do teclado
@@ -87,27 +307,98 @@
  static uint8_t linhas_selecionadas[PIN_LENGTH];                      // Linhas selecionadas pelo usuário
  static int matriz_digitos[NUM_LINES][NUMBERS_PER_LINE];              // Matriz de dígitos nas linhas
  
+ /**
+  * @brief Melodias do resultado; os LEDs seguem os roteiros abaixo
+  * 
+  * Frequências em Hz. Os valores antigos eram 16 vezes maiores: o beep
+  * contava com wrap de 4096, mas o PWM usava o padrão de 65536.
+  */
+ static const nota_t notas_sucesso[] = {
+     {622, 125}, {698, 125}, {370, 125}, {698, 125},
+     {370, 125}, {415, 125}, {370, 125}, {415, 125},
+     {466, 125}, {415, 125}, {466, 125}, {466, 125},
+ };
+ static const nota_t notas_falha[] = {
+     {196, 500}, {131, 1000},
+ };
+ static const melodia_t melodia_sucesso = MELODIA(notas_sucesso);
+ static const melodia_t melodia_falha = MELODIA(notas_falha);
+ 
+ /**
+  * @brief Roteiros dos LEDs, acompanhando os fades do resultado no display
+  */
+ static const led_efeito_t verde_ocioso = {LED_RESPIRAR, 0, BRILHO_OCIOSO, RESPIRACAO_MS, 0, NULL};
+ static const led_efeito_t verde_sucesso_fim = {LED_FADE, 255, 0, 0, FADE_MS, NULL};
+ static const led_efeito_t verde_sucesso_aceso = {LED_FIXO, 0, 255, 0, RESULTADO_MS, &verde_sucesso_fim};
+ static const led_efeito_t verde_sucesso = {LED_FADE, 0, 255, 0, FADE_MS, &verde_sucesso_aceso};
+ static const led_efeito_t verde_apagado = {LED_FIXO, 0, 0, 0, 2 * FADE_MS + RESULTADO_MS, NULL};
+ static const led_efeito_t vermelho_bloqueio_fim = {LED_FADE, 255, 0, 0, FADE_MS, NULL};
+ static const led_efeito_t vermelho_bloqueio = {LED_PULSAR, 0, 255, PULSO_BLOQUEIO_MS, FADE_MS + RESULTADO_MS, &vermelho_bloqueio_fim};
+ 
+ /**
+  * @brief Tarefas do loop principal
+  */
+ static tarefa_t tarefa_quadro;      // Envio periódico dos quadros
+ static tarefa_t tarefa_display;     // Recuperação dos displays
+ static tarefa_t tarefa_entrada;     // Fila de eventos, agendada pelas interrupções
+ static tarefa_t tarefa_resultado;   // Próxima etapa do resultado
+ static tarefa_t tarefa_abertura;    // Fim da tela de abertura
+ #ifdef DISPLAY_CINZA
+ static tarefa_t tarefa_cinza;       // Próximo plano de cinza, agendada pelo timer
+ #endif
+ 
+ /**
+  * @brief Etapas do resultado na tela, cada uma numa execução de tarefa_resultado
+  */
+ typedef enum {
+     RESULTADO_FADE_ENTRADA,
+     RESULTADO_EXIBINDO,
+     RESULTADO_FADE_SAIDA,
+     RESULTADO_ROLAGEM
+ } etapa_resultado_t;
+ 
+ static ssd1306_transition_t transicao;      // Transição da etapa atual
+ static etapa_resultado_t etapa_resultado;
+ static bool resultado_valido;
+ 
  /**
   * @brief Protótipos de funções
   */
  // Funções de inicialização
  void inicializar_display(void);
+ #ifdef SSD1306_CAPTURE
+ static void enviar_captura(void *ctx, const uint8_t *dados, size_t tamanho);
+ #endif
+ #ifdef DISPLAY_CINZA
+ void atualizar_cinza(void);
+ #endif
+ #ifdef DISPLAY_STATUS
+ void inicializar_status(void);
+ void atualizar_status(void);
+ #endif
  void inicializar_joystick(void);
  void inicializar_pwm_led(uint led_pin);
  void inicializar_pwm_buzzer(uint pin);
  
+ // Tarefas
+ void enviar_quadro(void *ctx);
+ void verificar_display(void *ctx);
+ void tratar_entrada(void *ctx);
+ void avancar_resultado(void *ctx);
+ void terminar_abertura(void *ctx);
+ 
  // Funções de interface
- void escrever_texto(char *str, uint32_t x, uint32_t y, bool limpar);
  void mostrar_selecao(uint8_t linha);
  void definir_linhas(void);
+ void limpar_senha(void);
  
  // Funções de entrada
- void verificar_joystick(void);
+ void digitar(void);
  void ler_joystick_x(uint16_t *eixo_x);
+ static bool amostrar_joystick(repeating_timer_t *rt);
  static void manipulador_interrupcao_gpio(uint gpio, uint32_t evento);
  
  // Funções de áudio e feedback
- void emitir_beep(uint pin, uint frequencia, uint duracao_ms);
  void tocar_melodia(bool resultado);
  
  // Funções de processamento
@@ -115,21 +406,252 @@
  void verificar_senha(uint8_t *linhas_selecionadas);
  
  /**
-  * @brief Inicializa o display OLED via I2C
+  * @brief Inicializa o display OLED via I2C ou SPI
   */
  void inicializar_display(void) {
-     i2c_init(i2c1, 400000);  // Inicializa I2C a 400kHz
+ #ifdef DISPLAY_SPI
+     static ssd1306_spi_t transporte;
+     
+     spi_init(spi0, DISPLAY_SPI_FREQ);
+     
+     // Configura pinos SPI (CS, DC e RST são controlados pelo driver)
+     gpio_set_function(DISPLAY_SPI_SCK, GPIO_FUNC_SPI);
+     gpio_set_function(DISPLAY_SPI_MOSI, GPIO_FUNC_SPI);
+     
+     ssd1306_transport_t *barramento = ssd1306_spi_init(&transporte, spi0, DISPLAY_SPI_CS,
+                                                        DISPLAY_SPI_DC, DISPLAY_SPI_RST);
+ #else
+     static ssd1306_i2c_t transporte;
+     
+     i2c_init(i2c1, DISPLAY_I2C_FREQ);
      
      // Configura pinos I2C
-     gpio_set_function(14, GPIO_FUNC_I2C);  // SDA
-     gpio_set_function(15, GPIO_FUNC_I2C);  // SCL
-     gpio_pull_up(14);
-     gpio_pull_up(15);
+     gpio_set_function(DISPLAY_I2C_SDA, GPIO_FUNC_I2C);
+     gpio_set_function(DISPLAY_I2C_SCL, GPIO_FUNC_I2C);
+     gpio_pull_up(DISPLAY_I2C_SDA);
+     gpio_pull_up(DISPLAY_I2C_SCL);
+     
+     ssd1306_transport_t *barramento = ssd1306_i2c_init(&transporte, i2c1, DISPLAY_I2C_ADDR);
+     
+     // Permite destravar o barramento se o display segurar SDA
+     ssd1306_i2c_set_recovery(&transporte, DISPLAY_I2C_SDA, DISPLAY_I2C_SCL, DISPLAY_I2C_FREQ);
+ #endif
  
      // Inicializa display OLED
      disp.external_vcc = false;
-     ssd1306_init(&disp, 128, 64, 0x3C, i2c1);
+     ssd1306_init_transport(&disp, 128, 64, barramento);
      ssd1306_clear(&disp);
+     ssd1306_frame_init(&quadro, &disp, DISPLAY_QUADROS_POR_SEGUNDO);
+ #ifdef SSD1306_CAPTURE
+     ssd1306_capture_attach(&captura, &disp, enviar_captura, NULL);
+ #endif
+     
+     // Pré-renderiza os dígitos de cada linha do teclado
+     for (int i = 0; i < NUM_LINES; i++) {
+         ssd1306_atlas_init(&atlas_digitos[i], font_8x5, KEYPAD_ESCALA, linha_y[i] & 7, '0', '9',
+                            atlas_memoria[i], sizeof(atlas_memoria[i]));
+     }
+     
+     // Campo da senha: só os blocos do campo pertencem ao mapa
+     ssd1306_tile_from_char(&blocos_senha[BLOCO_ASTERISCO * SSD1306_TILE_BYTES], font_8x5, '*');
+     ssd1306_tilemap_init(&mapa_senha, &disp, blocos_senha, 2);
+ 
+ #ifdef DISPLAY_CINZA
+     ssd1306_gray_init(&cinza, &disp);
+ #endif
+ }
+ 
+ #ifdef SSD1306_CAPTURE
+ /**
+  * @brief Envia um pacote da captura pelo USB, sem troca de \n por \r\n
+  */
+ static void enviar_captura(void *ctx, const uint8_t *dados, size_t tamanho) {
+     for (size_t i = 0; i < tamanho; i++) {
+         putchar_raw(dados[i]);
+     }
+ }
+ #endif
+ 
+ #ifdef DISPLAY_CINZA
+ /**
+  * @brief Copia o framebuffer para os planos, apagando as linhas fora do cursor
+  * 
+  * O que foi desenhado vai para o display pelos planos; o agendador de
+  * quadros encontra o framebuffer limpo e só dá o ritmo.
+  */
+ void atualizar_cinza(void) {
+     ssd1306_gray_from_mono(&cinza, 0, 0, disp.width, disp.height, SSD1306_GRAY_MAX);
+     
+     for (int i = 0; i < NUM_LINES; i++) {
+         if (i != linha_cursor) {
+             ssd1306_gray_from_mono(&cinza, DIGITO_X, linha_y[i], disp.width - DIGITO_X,
+                                    8 * KEYPAD_ESCALA, CINZA_APAGADO);
+         }
+     }
+     
+     ssd1306_gray_commit(&cinza);
+ }
+ 
+ /**
+  * @brief Tarefa: envia o plano de cinza que o timer marcou
+  * 
+  * No i2c o envio pode esperar ou recuperar o barramento, o que não cabe
+  * na interrupção do timer; ela só agenda esta tarefa.
+  */
+ void enviar_plano_cinza(void *ctx) {
+     ssd1306_gray_service(&cinza);
+ }
+ 
+ /**
+  * @brief Chamada pelo timer dos planos, em contexto de interrupção
+  */
+ static void acordar_cinza(void *ctx) {
+     agenda_depois(&tarefa_cinza, 0);
+ }
+ #endif
+ 
+ #ifdef DISPLAY_STATUS
+ /**
+  * @brief Inicializa a tela de status no i2c0
+  */
+ void inicializar_status(void) {
+     static ssd1306_i2c_t transporte;
+     
+     i2c_init(i2c0, DISPLAY_I2C_FREQ);
+     
+     gpio_set_function(STATUS_I2C_SDA, GPIO_FUNC_I2C);
+     gpio_set_function(STATUS_I2C_SCL, GPIO_FUNC_I2C);
+     gpio_pull_up(STATUS_I2C_SDA);
+     gpio_pull_up(STATUS_I2C_SCL);
+     
+     ssd1306_transport_t *barramento = ssd1306_i2c_init(&transporte, i2c0, STATUS_I2C_ADDR);
+     ssd1306_i2c_set_recovery(&transporte, STATUS_I2C_SDA, STATUS_I2C_SCL, DISPLAY_I2C_FREQ);
+     
+     tela_status.external_vcc = false;
+     ssd1306_init_transport(&tela_status, 128, 64, barramento);
+     ssd1306_frame_init(&quadro_status, &tela_status, DISPLAY_QUADROS_POR_SEGUNDO);
+     atualizar_status();
+ }
+ 
+ /**
+  * @brief Redesenha a tela de status
+  * 
+  * O envio fica para o próximo quadro da tela de status, que corre em
+  * paralelo com o do display principal, cada um no seu controlador I2C.
+  */
+ void atualizar_status(void) {
+     const ssd1306_bus_stats_t *barramento = ssd1306_bus_stats(&disp);
+     char linha[24];
+     
+     ssd1306_clear(&tela_status);
+     ssd1306_draw_string(&tela_status, 0, 0, 1, "STATUS");
+     snprintf(linha, sizeof(linha), "TENTATIVAS %lu", (unsigned long) tentativas);
+     ssd1306_draw_string(&tela_status, 0, 16, 1, linha);
+     snprintf(linha, sizeof(linha), "ACERTOS %lu", (unsigned long) acertos);
+     ssd1306_draw_string(&tela_status, 0, 26, 1, linha);
+     ssd1306_draw_string(&tela_status, 0, 42, 1,
+                         barramento->consecutive_failures < DISPLAY_FALHAS_MAX ? "DISPLAY OK" : "DISPLAY FALHOU");
+     snprintf(linha, sizeof(linha), "FALHAS %lu", (unsigned long) barramento->failures);
+     ssd1306_draw_string(&tela_status, 0, 52, 1, linha);
+ }
+ #endif
+ 
+ /**
+  * @brief Tenta recuperar os displays que pararam de responder
+  * 
+  * Roda a cada DISPLAY_NOVA_TENTATIVA_MS pela tarefa_display.
+  * 
+  * Sem display o teclado continua funcionando às cegas: LEDs e buzzer
+  * seguem indicando o resultado da senha.
+  */
+ void verificar_display(void *ctx) {
+     for (size_t i = 0; i < NUM_TELAS; i++) {
+         if (ssd1306_bus_stats(telas[i])->consecutive_failures < DISPLAY_FALHAS_MAX) {
+             continue;
+         }
+         
+         // Reenvia a inicialização; a tela inteira vai no próximo quadro
+ #ifdef DISPLAY_CINZA
+         if (telas[i] == &disp) {
+             ssd1306_gray_stop(&cinza);
+             ssd1306_reset(telas[i]);
+             ssd1306_gray_start(&cinza, CINZA_PLANOS_POR_SEGUNDO);  // O primeiro plano vai inteiro
+             continue;
+         }
+ #endif
+         ssd1306_reset(telas[i]);
+     }
+ }
+ 
+ /**
+  * @brief Tarefa periódica: envia o que foi desenhado desde o último quadro
+  * 
+  * Durante a abertura e o resultado as etapas enviam o display principal
+  * por conta própria; só a tela de status segue no ritmo.
+  */
+ void enviar_quadro(void *ctx) {
+     if (!bloqueado) {
+ #ifdef DISPLAY_CINZA
+         atualizar_cinza();
+ #endif
+         ssd1306_frame_present(&quadro);
+     }
+ #ifdef DISPLAY_STATUS
+     ssd1306_frame_present(&quadro_status);
+ #endif
+ }
+ 
+ /**
+  * @brief Tarefa: retira os eventos de entrada em lotes e aplica na ordem
+  * 
+  * Cada aperto usa a linha em que o cursor estava na hora dele, mesmo que
+  * o joystick tenha andado depois. O que o lote mudou na tela vai num
+  * quadro só, no fim. Com a entrada bloqueada os eventos são descartados;
+  * um aperto que completa a senha bloqueia o resto do lote.
+  */
+ void tratar_entrada(void *ctx) {
+     evento_t lote[ENTRADA_LOTE];
+     uint32_t n;
+     bool mudou = false;
+     
+     while ((n = eventos_retirar(lote, ENTRADA_LOTE)) > 0) {
+         for (uint32_t i = 0; i < n; i++) {
+             switch (lote[i].tipo) {
+                 case EVENTO_BOTAO_DESCE:
+                     // Debounce: vale o aperto que vem depois de um tempo sem bordas
+                     if (!bloqueado && lote[i].tempo_us - ultima_borda_us >= DEBOUNCE_TIME_MS * 1000) {
+                         digitar();
+                         mudou = true;
+                     }
+                     ultima_borda_us = lote[i].tempo_us;
+                     break;
+                 
+                 case EVENTO_BOTAO_SOBE:
+                     ultima_borda_us = lote[i].tempo_us;
+                     break;
+                 
+                 case EVENTO_JOYSTICK_CIMA:
+                     if (!bloqueado && linha_atual != 0) {
+                         linha_atual--;
+                         mudou = true;
+                     }
+                     break;
+                 
+                 case EVENTO_JOYSTICK_BAIXO:
+                     if (!bloqueado && linha_atual != NUM_LINES - 1) {
+                         linha_atual++;
+                         mudou = true;
+                     }
+                     break;
+             }
+         }
+     }
+     
+     if (mudou && !bloqueado) {
+         mostrar_selecao(linha_atual);
+         ssd1306_tilemap_draw(&mapa_senha);  // Só os blocos que mudaram
+         enviar_quadro(NULL);
+     }
  }
  
  /**
@@ -173,67 +695,16 @@
      pwm_set_gpio_level(pin, 0);
  }
  
- /**
-  * @brief Emite um beep com frequência e duração especificadas
-  * 
-  * @param pin Pino do buzzer
-  * @param frequencia Frequência do beep em Hz
-  * @param duracao_ms Duração do beep em milissegundos
-  */
- void emitir_beep(uint pin, uint frequencia, uint duracao_ms) {
-     uint slice_num = pwm_gpio_to_slice_num(pin);
-     
-     // Configura PWM para frequência desejada
-     pwm_config config = pwm_get_default_config();
-     pwm_config_set_clkdiv(&config, clock_get_hz(clk_sys) / (frequencia * 4096));
-     pwm_init(slice_num, &config, true);
-     
-     // 50% duty cycle
-     pwm_set_gpio_level(pin, 2048);
-     
-     sleep_ms(duracao_ms);
-     
-     // Desativa saída
-     pwm_set_gpio_level(pin, 0);
- }
- 
  /**
   * @brief Toca melodia de acordo com o resultado da validação da senha
   * 
+  * Retorna na hora: as notas e o LED do resultado seguem por alarme,
+  * enquanto o display faz as transições.
+  * 
   * @param resultado true para senha correta, false para incorreta
   */
  void tocar_melodia(bool resultado) {
-     if (resultado) {
-         // Acende LED verde
-         pwm_set_gpio_level(LED_PIN_GREEN, PWM_LED_LEVEL);
-         
-         // Melodia para senha correta
-         emitir_beep(BUZZER_PIN, 9956, 125);
-         emitir_beep(BUZZER_PIN, 11178, 125);
-         emitir_beep(BUZZER_PIN, 5916, 125);
-         emitir_beep(BUZZER_PIN, 11178, 125);
-         emitir_beep(BUZZER_PIN, 5916, 125);
-         emitir_beep(BUZZER_PIN, 6641, 125);
-         emitir_beep(BUZZER_PIN, 5916, 125);
-         emitir_beep(BUZZER_PIN, 6641, 125);
-         emitir_beep(BUZZER_PIN, 7457, 125);
-         emitir_beep(BUZZER_PIN, 6641, 125);
-         emitir_beep(BUZZER_PIN, 7457, 125);
-         emitir_beep(BUZZER_PIN, 7457, 125);
-         
-         // Apaga LED verde
-         pwm_set_gpio_level(LED_PIN_GREEN, 0);
-     } else {
-         // Acende LED vermelho
-         pwm_set_gpio_level(LED_PIN_RED, PWM_LED_LEVEL);
-         
-         // Melodia para senha incorreta
-         emitir_beep(BUZZER_PIN, 3136, 500);
-         emitir_beep(BUZZER_PIN, 2092, 1000);
-         
-         // Apaga LED vermelho
-         pwm_set_gpio_level(LED_PIN_RED, 0);
-     }
+     melodia_tocar(resultado ? &melodia_sucesso : &melodia_falha);
  }
  
  /**
@@ -261,52 +732,31 @@
   */
  void ler_joystick_x(uint16_t *eixo_x) {
      adc_select_input(ADC_CHANNEL_0);
-     sleep_us(2);  // Pequeno delay para estabilização
+     busy_wait_us_32(2);  // Pequeno delay para estabilização; roda em interrupção
      *eixo_x = adc_read();
  }
  
- /**
-  * @brief Mostra uma mensagem no display OLED
-  * 
-  * @param str String a ser mostrada
-  * @param x Posição X no display
-  * @param y Posição Y no display
-  * @param limpar Se true, limpa o display antes de desenhar
-  */
- void escrever_texto(char *str, uint32_t x, uint32_t y, bool limpar) {
-     if (limpar) {
-         ssd1306_clear(&disp);
-         sleep_ms(10);
-     }
-     ssd1306_draw_string(&disp, x, y, 1, str);
-     ssd1306_show(&disp);
- }
- 
  /**
   * @brief Mostra um indicador de seleção para a linha atual
   * 
+  * O cursor é desenhado com XOR: uma chamada apaga o cursor da linha
+  * anterior e outra o desenha na nova linha.
+  * 
   * @param linha Índice da linha selecionada (0-3)
   */
  void mostrar_selecao(uint8_t linha) {
-     uint32_t width = 3;
-     uint32_t height = 5;
-     uint32_t x = 20;
-     uint32_t y;
-     
-     // Determina posição Y baseada na linha
-     switch (linha) {
-         case 0: y = 5; break;
-         case 1: y = 20; break;
-         case 2: y = 35; break;
-         case 3: y = 50; break;
-         default: y = 5; break;
+     if (linha >= NUM_LINES) {
+         linha = 0;
      }
      
-     sleep_ms(50);
-     
-     // Desenha quadrado de seleção
-     ssd1306_draw_square(&disp, x, y, width, height);
-     ssd1306_show(&disp);
+     if (linha != linha_cursor) {
+         // Apaga o cursor anterior e desenha o novo
+         if (linha_cursor < NUM_LINES) {
+             ssd1306_invert_rect(&disp, CURSOR_X, cursor_y[linha_cursor], CURSOR_WIDTH, CURSOR_HEIGHT);
+         }
+         ssd1306_invert_rect(&disp, CURSOR_X, cursor_y[linha], CURSOR_WIDTH, CURSOR_HEIGHT);
+         linha_cursor = linha;
+     }
  }
  
  /**
@@ -345,24 +795,17 @@
          }
      }
      
-     // Mostra as linhas no display
-     char buffer[10];
-     
-     // Linha 0
-     sprintf(buffer, "%d %d %d", matriz_digitos[0][0], matriz_digitos[0][1], matriz_digitos[0][2]);
-     escrever_texto(buffer, 30, 5, true);
-     
-     // Linha 1
-     sprintf(buffer, "%d %d %d", matriz_digitos[1][0], matriz_digitos[1][1], matriz_digitos[1][2]);
-     escrever_texto(buffer, 30, 20, false);
-     
-     // Linha 2
-     sprintf(buffer, "%d %d %d", matriz_digitos[2][0], matriz_digitos[2][1], matriz_digitos[2][2]);
-     escrever_texto(buffer, 30, 35, false);
+     // Mostra as linhas no display copiando os glifos prontos
+     ssd1306_clear(&disp);
+     linha_cursor = CURSOR_NENHUM;  // O cursor foi apagado junto
+     ssd1306_tilemap_invalidate(&mapa_senha);  // E o campo da senha também
      
-     // Linha 3
-     sprintf(buffer, "%d %d %d", matriz_digitos[3][0], matriz_digitos[3][1], matriz_digitos[3][2]);
-     escrever_texto(buffer, 30, 50, false);
+     for (int i = 0; i < NUM_LINES; i++) {
+         for (int j = 0; j < NUMBERS_PER_LINE; j++) {
+             ssd1306_atlas_draw_char(&disp, &atlas_digitos[i], DIGITO_X + j * DIGITO_PASSO, linha_y[i] >> 3,
+                                     '0' + matriz_digitos[i][j]);
+         }
+     }
      
      // Reinicia array de linhas selecionadas
      for (int i = 0; i < PIN_LENGTH; i++) {
@@ -371,42 +814,62 @@
  }
  
  /**
-  * @brief Verifica entrada do joystick e atualiza linha selecionada
+  * @brief Apaga os asteriscos do campo da senha
+  */
+ void limpar_senha(void) {
+     for (int i = 0; i < PIN_LENGTH; i++) {
+         ssd1306_tilemap_set(&mapa_senha, SENHA_COLUNA + i, SENHA_LINHA, BLOCO_VAZIO);
+     }
+     ssd1306_tilemap_draw(&mapa_senha);
+ }
+ 
+ /**
+  * @brief Amostra o joystick e publica um passo se ele estiver inclinado
+  * 
+  * Roda na interrupção do timer, com a mesma prioridade da do botão:
+  * as duas juntas são o único produtor da fila de eventos.
   */
- void verificar_joystick(void) {
+ static bool amostrar_joystick(repeating_timer_t *rt) {
      uint16_t valor_x = 0;
      ler_joystick_x(&valor_x);
      
      // Baseado no valor lido, move para cima ou para baixo
-     if (valor_x < 1500 && linha_atual != 3) {
-         linha_atual++;
-         ssd1306_clear_square(&disp, 17, 1, 8, 60);
-     } else if (valor_x > 2600 && linha_atual != 0) {
-         linha_atual--;
-         ssd1306_clear_square(&disp, 17, 1, 8, 60);
+     if (valor_x < 1500) {
+         eventos_publicar(EVENTO_JOYSTICK_BAIXO, time_us_32());
+         agenda_depois(&tarefa_entrada, 0);
+     } else if (valor_x > 2600) {
+         eventos_publicar(EVENTO_JOYSTICK_CIMA, time_us_32());
+         agenda_depois(&tarefa_entrada, 0);
      }
-     
-     mostrar_selecao(linha_atual);
+     return true;
  }
  
  /**
   * @brief Manipulador de interrupção para o botão
   * 
+  * Publica as duas bordas com o horário; o debounce e o resto ficam para
+  * o loop principal, logo que a interrupção volta.
+  * 
   * @param gpio Pino GPIO que gerou a interrupção
   * @param evento Tipo de evento que causou a interrupção
   */
  static void manipulador_interrupcao_gpio(uint gpio, uint32_t evento) {
-     absolute_time_t tempo_atual = get_absolute_time();
+     const uint32_t agora = time_us_32();
      
-     // Verifica debounce
-     if (absolute_time_diff_us(last_button_time, tempo_atual) > DEBOUNCE_TIME_MS * 1000) {
-         button_pressed = true;
-         last_button_time = tempo_atual;
+     if (evento & GPIO_IRQ_EDGE_FALL) {
+         eventos_publicar(EVENTO_BOTAO_DESCE, agora);
      }
+     if (evento & GPIO_IRQ_EDGE_RISE) {
+         eventos_publicar(EVENTO_BOTAO_SOBE, agora);
+     }
+     agenda_depois(&tarefa_entrada, 0);
  }
  
  /**
-  * @brief Verifica se a senha digitada está correta
+  * @brief Verifica se a senha digitada está correta e começa a mostrar o resultado
+  * 
+  * O fade, a espera e a volta do teclado seguem na tarefa_resultado; a
+  * entrada fica bloqueada até lá.
   * 
   * @param linhas_selecionadas Array com as linhas selecionadas pelo usuário
   */
@@ -434,21 +897,142 @@
          }
      }
      
-     // Mostra resultado
+ #ifdef DISPLAY_STATUS
+     tentativas++;
      if (senha_valida) {
-         escrever_texto("SENHA CORRETA", 20, 5, true);
+         acertos++;
+     }
+     atualizar_status();
+     ssd1306_frame_present(&quadro_status);  // Vai pelo i2c0 enquanto o resultado vai pelo i2c1
+ #endif
+     
+ #ifdef DISPLAY_CINZA
+     // As transições mexem direto no display, os planos param até o teclado voltar
+     ssd1306_gray_stop(&cinza);
+     printf("cinza: %lu planos/s sustentados, %lu perdidos, maior plano %lu us\n",
+            (unsigned long) ssd1306_gray_plane_rate(&cinza),
+            (unsigned long) ssd1306_gray_stats(&cinza)->missed,
+            (unsigned long) ssd1306_gray_stats(&cinza)->max_us);
+ #endif
+     printf("entrada: %lu eventos perdidos com a fila cheia\n", (unsigned long) eventos_perdidos());
+     
+     // Mostra resultado: o texto surge com fade e corre pela tela no scroll do display
+     if (senha_valida) {
+         leds_efeito(LED_VERDE, &verde_sucesso);
      } else {
-         escrever_texto("SENHA INCORRETA", 20, 5, true);
+         leds_efeito(LED_VERDE, &verde_apagado);
+         leds_efeito(LED_VERMELHO, &vermelho_bloqueio);
      }
      
-     // Toca melodia de acordo com resultado
-     tocar_melodia(senha_valida);
+     bloqueado = true;
+     ssd1306_contrast(&disp, 0);
+     ssd1306_image_draw(&disp, senha_valida ? &tela_senha_correta : &tela_senha_incorreta, 0, 0);
+     linha_cursor = CURSOR_NENHUM;  // A tela inteira foi substituída, cursor junto
+     ssd1306_tilemap_invalidate(&mapa_senha);
+     ssd1306_frame_present(&quadro);
+     ssd1306_fade_begin(&transicao, 0, CONTRASTE_MAX, FADE_MS);
      
-     // Aguarda e reinicia o sistema
-     sleep_ms(2500);
-     definir_linhas();
+     // O resto segue em etapas, sem prender o loop principal
+     resultado_valido = senha_valida;
+     etapa_resultado = RESULTADO_FADE_ENTRADA;
+     agenda_depois(&tarefa_resultado, 0);
  }
-
+ 
+ /**
+  * @brief Tarefa: avança o resultado na tela e volta ao teclado no fim
+  * 
+  * Cada transição anda um passo por execução, a cada SSD1306_FRAME_MS.
+  */
+ void avancar_resultado(void *ctx) {
+     if (etapa_resultado != RESULTADO_EXIBINDO && ssd1306_transition_step(&disp, &transicao)) {
+         agenda_depois(&tarefa_resultado, SSD1306_FRAME_MS);
+         return;
+     }
+     
+     switch (etapa_resultado) {
+         case RESULTADO_FADE_ENTRADA:
+             ssd1306_scroll_horizontal(&disp, true, 0, PAGINAS_RESULTADO, SSD1306_SCROLL_2_FRAMES);
+             
+             // Toca melodia de acordo com resultado, sem esperar ela terminar
+             tocar_melodia(resultado_valido);
+             
+             etapa_resultado = RESULTADO_EXIBINDO;
+             agenda_depois(&tarefa_resultado, RESULTADO_MS);
+             break;
+         
+         case RESULTADO_EXIBINDO:
+             // Apaga o resultado
+             ssd1306_fade_begin(&transicao, CONTRASTE_MAX, 0, FADE_MS);
+             etapa_resultado = RESULTADO_FADE_SAIDA;
+             agenda_depois(&tarefa_resultado, 0);
+             break;
+         
+         case RESULTADO_FADE_SAIDA:
+             ssd1306_scroll_stop(&disp);
+             
+             // Reinicia o sistema; o teclado novo entra girando uma volta
+             definir_linhas();
+             mostrar_selecao(linha_atual);    // definir_linhas apagou o cursor
+             char_count = 0;
+             limpar_senha();
+             ssd1306_frame_present(&quadro);  // O teclado novo inteiro numa só transferência
+             ssd1306_contrast(&disp, CONTRASTE_MAX);
+             ssd1306_roll_begin(&transicao, true, 64, ROLAGEM_MS);
+             etapa_resultado = RESULTADO_ROLAGEM;
+             agenda_depois(&tarefa_resultado, 0);
+             break;
+         
+         case RESULTADO_ROLAGEM:
+ #ifdef DISPLAY_CINZA
+             atualizar_cinza();
+             ssd1306_gray_start(&cinza, CINZA_PLANOS_POR_SEGUNDO);
+ #endif
+             bloqueado = false;
+             break;
+     }
+ }
+ 
+ /**
+  * @brief Digita a linha atual como mais um dígito da senha
+  * 
+  * Ao completar a senha mostra o último asterisco e verifica, o que
+  * bloqueia a entrada.
+  */
+ void digitar(void) {
+     if (char_count < PIN_LENGTH) {
+         // Armazena a linha selecionada
+         linhas_selecionadas[char_count] = linha_atual;
+         
+         // Mostra mais um asterisco
+         ssd1306_tilemap_set(&mapa_senha, SENHA_COLUNA + char_count, SENHA_LINHA, BLOCO_ASTERISCO);
+         char_count++;
+         leds_piscar(LED_VERDE, PISCADA_MS);
+     }
+     
+     // Se completou a senha, verifica
+     if (char_count == PIN_LENGTH) {
+         ssd1306_tilemap_draw(&mapa_senha);
+         enviar_quadro(NULL);
+         verificar_senha(linhas_selecionadas);
+     }
+ }
+ 
+ /**
+  * @brief Tarefa: sai da tela de abertura para o teclado
+  */
+ void terminar_abertura(void *ctx) {
+     mostrar_selecao(linha_atual);
+ #ifdef DISPLAY_CINZA
+     atualizar_cinza();
+     ssd1306_gray_start(&cinza, CINZA_PLANOS_POR_SEGUNDO);
+ #endif
+     bloqueado = false;
+     enviar_quadro(NULL);
+     
+     agenda_periodica(&tarefa_quadro, 1000 / DISPLAY_QUADROS_POR_SEGUNDO);
+     add_repeating_timer_ms(-JOYSTICK_MS, amostrar_joystick, NULL, &timer_joystick);
+ }
+ 
   /**
   * @brief Função de inicialização do sistema e dispositivos
   */
@@ -456,13 +1040,25 @@
      // Inicialização do sistema
      stdio_init_all();
      inicializar_display();
+ #ifdef DISPLAY_STATUS
+     inicializar_status();
+ #endif
+     
+     // Abertura direto para o display; o primeiro quadro a substitui
+     ssd1306_image_send(&disp, &tela_abertura, 0, 0);
+     absolute_time_t fim_abertura = make_timeout_time_ms(ABERTURA_MS);
+ 
+ #ifdef SRK_BENCHMARK
+     sleep_ms(2000);  // Tempo para o terminal USB conectar
+     benchmark_executar(&disp);
+ #endif
      inicializar_joystick();
      
      // Configura botão com pull-up e interrupção
      gpio_init(BUTTON_R);
      gpio_set_dir(BUTTON_R, GPIO_IN);
      gpio_pull_up(BUTTON_R);
-     gpio_set_irq_enabled_with_callback(BUTTON_R, GPIO_IRQ_EDGE_FALL, true, &manipulador_interrupcao_gpio);
+     gpio_set_irq_enabled_with_callback(BUTTON_R, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, &manipulador_interrupcao_gpio);
      
      // Configura LEDs
      gpio_init(LED_PIN_GREEN);
@@ -473,17 +1069,35 @@
      // Inicializa PWM para LEDs
      inicializar_pwm_led(LED_PIN_GREEN);
      inicializar_pwm_led(LED_PIN_RED);
+     leds_init(LED_PIN_GREEN, LED_PIN_RED, PWM_LED_LEVEL);
+     leds_base(LED_VERDE, &verde_ocioso);
      
      // Configura buzzer
      gpio_init(BUZZER_PIN);
      gpio_set_dir(BUZZER_PIN, GPIO_OUT);
      inicializar_pwm_buzzer(BUZZER_PIN);
+     melodia_init(BUZZER_PIN);
      
      // Inicializa teclado randomizado
      definir_linhas();
      
-     // Inicializa string de exibição da senha
-     senha_display[0] = '\0';
+     // Inicializa o campo da senha
+     limpar_senha();
+     
+     // Tarefas; o teclado aparece quando a abertura completar o seu tempo
+     tarefa_init(&tarefa_quadro, enviar_quadro, NULL);
+     tarefa_init(&tarefa_display, verificar_display, NULL);
+     tarefa_init(&tarefa_entrada, tratar_entrada, NULL);
+     tarefa_init(&tarefa_resultado, avancar_resultado, NULL);
+     tarefa_init(&tarefa_abertura, terminar_abertura, NULL);
+ #ifdef DISPLAY_CINZA
+     tarefa_init(&tarefa_cinza, enviar_plano_cinza, NULL);
+     ssd1306_gray_set_wake(&cinza, acordar_cinza, NULL);
+ #endif
+     
+     int64_t resta_us = absolute_time_diff_us(get_absolute_time(), fim_abertura);
+     agenda_depois(&tarefa_abertura, resta_us > 0 ? resta_us / 1000 : 0);
+     agenda_periodica(&tarefa_display, DISPLAY_NOVA_TENTATIVA_MS);
  }
  
  /**
@@ -494,36 +1108,8 @@
     // Inicialização do sistema e dispositivos
     srk_init();
      
-     // Loop principal
+     // Loop principal: executa as tarefas vencidas e dorme até a próxima ou uma interrupção
      while (true) {
-         // Verifica joystick para navegação
-         verificar_joystick();
-         
-         // Processa botão pressionado
-         if (button_pressed) {
-             if (char_count < PIN_LENGTH) {
-                 // Armazena a linha selecionada
-                 linhas_selecionadas[char_count] = linha_atual;
-                 
-                 // Atualiza string de exibição (asteriscos)
-                 senha_display[char_count] = '*';
-                 senha_display[char_count + 1] = '\0';
-                 char_count++;
-             }
-             
-             // Atualiza display
-             ssd1306_clear_square(&disp, 80, 27, 48, 8);
-             escrever_texto(senha_display, 80, 27, false);
-             button_pressed = false;
-             
-             // Se completou a senha, verifica
-             if (char_count == PIN_LENGTH) {
-                 verificar_senha(linhas_selecionadas);
-                 char_count = 0;
-                 senha_display[0] = '\0';
-             }
-         }
-         
-         sleep_ms(50);  // Pequeno delay para melhor controle
+         agenda_executar();
      }
  }
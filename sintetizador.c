@@ -0,0 +1,181 @@
+/**
+ * @file sintetizador.c
+ * @brief Vozes, envelopes e mistura do sintetizador, sem nada de hardware
+ * @author Andre de Oliveira Melo
+ */
+
+ #include <math.h>
+ #include "pico/stdlib.h"
+ #include "hardware/sync.h"
+ #include "sintetizador.h"
+
+ #define NIVEL_MAX (255u << 16)      // Volume máximo do envelope, ponto fixo 8.16
+
+ typedef enum {
+     PARADA,
+     ATAQUE,
+     DECAIMENTO,
+     SUSTENTACAO,
+     LIBERACAO
+ } estagio_t;
+
+ typedef struct {
+     const int8_t *tabela;   // Onda tocando
+     uint32_t fase;          // Posição na tabela, 8 bits de índice no topo
+     uint32_t incremento;    // Avanço da fase por amostra
+     uint32_t nivel;         // Volume atual, ponto fixo 8.16
+     uint32_t passo;         // Variação do volume por amostra no estágio
+     uint32_t restantes;     // Amostras até a liberação
+     estagio_t estagio;
+     envelope_t envelope;
+ } voz_t;
+
+ static int8_t tabelas[NUM_ONDAS][256];
+ static voz_t vozes[SINTETIZADOR_VOZES];
+ static uint32_t taxa_amostras = SINTETIZADOR_TAXA;
+
+ /**
+  * @brief Converte milissegundos em amostras, no mínimo 1
+  */
+ static uint32_t amostras(uint32_t ms) {
+     uint32_t n = (uint32_t) ((uint64_t) ms * taxa_amostras / 1000);
+     return n ? n : 1;
+ }
+
+ /**
+  * @brief Passa a voz para a liberação, a partir do volume em que está
+  */
+ static void liberar(voz_t *v) {
+     v->estagio = LIBERACAO;
+     v->passo = v->nivel / amostras(v->envelope.liberacao_ms);
+     if (!v->passo) {
+         v->passo = 1;
+     }
+ }
+
+ /**
+  * @brief Avança o envelope de uma voz em uma amostra
+  */
+ static void avancar_envelope(voz_t *v) {
+     const uint32_t sustentacao = (uint32_t) v->envelope.sustentacao << 16;
+
+     switch (v->estagio) {
+         case ATAQUE:
+             if (v->nivel + v->passo >= NIVEL_MAX) {
+                 v->nivel = NIVEL_MAX;
+                 v->estagio = DECAIMENTO;
+                 v->passo = (NIVEL_MAX - sustentacao) / amostras(v->envelope.decaimento_ms);
+             } else {
+                 v->nivel += v->passo;
+             }
+             break;
+         case DECAIMENTO:
+             if (v->nivel <= sustentacao + v->passo) {
+                 v->nivel = sustentacao;
+                 v->estagio = SUSTENTACAO;
+             } else {
+                 v->nivel -= v->passo;
+             }
+             break;
+         case SUSTENTACAO:
+             break;
+         case LIBERACAO:
+             if (v->nivel <= v->passo) {
+                 v->nivel = 0;
+                 v->estagio = PARADA;
+             } else {
+                 v->nivel -= v->passo;
+             }
+             return;
+         default:
+             return;
+     }
+
+     // A nota acabou: solta o envelope, esteja no estágio que estiver
+     if (!--v->restantes) {
+         liberar(v);
+     }
+ }
+
+ void sintetizador_init(uint32_t taxa) {
+     taxa_amostras = taxa;
+
+     for (int i = 0; i < 256; i++) {
+         tabelas[ONDA_QUADRADA][i] = i < 128 ? 127 : -127;
+         tabelas[ONDA_TRIANGULAR][i] = i < 128 ? -127 + 2 * i : 127 - 2 * (i - 128);
+         tabelas[ONDA_SENOIDE][i] = (int8_t) lroundf(127.0f * sinf(6.2831853f * i / 256.0f));
+     }
+
+     sintetizador_silenciar();
+ }
+
+ void sintetizador_nota(uint8_t voz, uint16_t frequencia, uint16_t duracao_ms, onda_t onda, const envelope_t *envelope) {
+     if (voz >= SINTETIZADOR_VOZES) {
+         return;
+     }
+
+     // A mistura roda na interrupção do DMA, a voz muda inteira de uma vez
+     uint32_t estado = save_and_disable_interrupts();
+     voz_t *v = &vozes[voz];
+
+     v->tabela = tabelas[onda];
+     v->fase = 0;
+     v->incremento = (uint32_t) (((uint64_t) frequencia << 32) / taxa_amostras);
+     v->envelope = *envelope;
+     v->nivel = 0;
+     v->estagio = ATAQUE;
+     v->passo = NIVEL_MAX / amostras(envelope->ataque_ms);
+     v->restantes = amostras(duracao_ms);
+
+     restore_interrupts(estado);
+ }
+
+ void sintetizador_soltar(uint8_t voz) {
+     if (voz >= SINTETIZADOR_VOZES) {
+         return;
+     }
+
+     uint32_t estado = save_and_disable_interrupts();
+     if (vozes[voz].estagio != PARADA && vozes[voz].estagio != LIBERACAO) {
+         liberar(&vozes[voz]);
+     }
+     restore_interrupts(estado);
+ }
+
+ void sintetizador_silenciar(void) {
+     uint32_t estado = save_and_disable_interrupts();
+     for (int i = 0; i < SINTETIZADOR_VOZES; i++) {
+         vozes[i].estagio = PARADA;
+         vozes[i].nivel = 0;
+     }
+     restore_interrupts(estado);
+ }
+
+ bool sintetizador_tocando(void) {
+     for (int i = 0; i < SINTETIZADOR_VOZES; i++) {
+         if (vozes[i].estagio != PARADA) {
+             return true;
+         }
+     }
+     return false;
+ }
+
+ void sintetizador_gerar(uint16_t *saida, uint32_t quantidade) {
+     for (uint32_t n = 0; n < quantidade; n++) {
+         int32_t mistura = 0;
+
+         for (int i = 0; i < SINTETIZADOR_VOZES; i++) {
+             voz_t *v = &vozes[i];
+
+             if (v->estagio == PARADA) {
+                 continue;
+             }
+             mistura += v->tabela[v->fase >> 24] * (int32_t) (v->nivel >> 16);
+             v->fase += v->incremento;
+             avancar_envelope(v);
+         }
+
+         // Duas vozes no máximo somam 2 * 127 * 255, que cabe em +-127 depois de >> 9
+         saida[n] = (uint16_t) (SINTETIZADOR_SILENCIO + (mistura >> 9));
+     }
+ }
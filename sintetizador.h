@@ -0,0 +1,104 @@
+/**
+ * @file sintetizador.h
+ * @brief Sintetizador de tabela de onda para o buzzer
+ * @author Andre de Oliveira Melo
+ *
+ * Duas vozes, cada uma com tabela de onda, acumulador de fase de 32 bits
+ * (frequência exata, sem o arredondamento do divisor do PWM) e envelope
+ * de volume. As amostras são misturadas em blocos; no Pico, sintetizador_pwm.c
+ * leva cada bloco ao registrador de comparação do PWM do buzzer por DMA,
+ * no ritmo de um timer de DMA. O mesmo código gera o arquivo WAV do
+ * renderizador no PC (host/synth_wav.c).
+ */
+
+ #ifndef SINTETIZADOR_H
+ #define SINTETIZADOR_H
+
+ #include "pico/stdlib.h"
+
+ #define SINTETIZADOR_TAXA 25000     // Amostras por segundo pedidas
+ #define SINTETIZADOR_VOZES 2
+ #define SINTETIZADOR_BLOCO 256      // Amostras por bloco de DMA
+ #define SINTETIZADOR_WRAP 255       // Amostra máxima = wrap do PWM
+ #define SINTETIZADOR_SILENCIO 128   // Amostra sem som (meio da faixa)
+
+ /**
+  * @brief Formas de onda disponíveis
+  */
+ typedef enum {
+     ONDA_QUADRADA,
+     ONDA_TRIANGULAR,
+     ONDA_SENOIDE,
+     NUM_ONDAS
+ } onda_t;
+
+ /**
+  * @brief Envelope de volume: ataque, decaimento, sustentação e liberação
+  */
+ typedef struct {
+     uint16_t ataque_ms;      // De 0 ao volume máximo
+     uint16_t decaimento_ms;  // Do máximo ao nível de sustentação
+     uint8_t sustentacao;     // Nível enquanto a nota dura, 0 a 255
+     uint16_t liberacao_ms;   // Do nível atual a 0, depois da nota
+ } envelope_t;
+
+ /**
+  * @brief Envelope das notas das melodias
+  */
+ #define SINTETIZADOR_ENVELOPE_PADRAO {5, 40, 180, 30}
+
+ /**
+  * @brief Prepara as tabelas de onda e silencia as vozes
+  *
+  * @param taxa Amostras por segundo realmente geradas
+  */
+ void sintetizador_init(uint32_t taxa);
+
+ /**
+  * @brief Começa uma nota numa voz, interrompendo a que ela tocava
+  *
+  * @param voz Voz, 0 a SINTETIZADOR_VOZES - 1
+  * @param frequencia Frequência em Hz
+  * @param duracao_ms Tempo até a liberação do envelope
+  * @param onda Forma de onda
+  * @param envelope Envelope de volume, copiado
+  */
+ void sintetizador_nota(uint8_t voz, uint16_t frequencia, uint16_t duracao_ms, onda_t onda, const envelope_t *envelope);
+
+ /**
+  * @brief Passa a voz para a liberação do envelope antes do fim da nota
+  */
+ void sintetizador_soltar(uint8_t voz);
+
+ /**
+  * @brief Cala todas as vozes na hora
+  */
+ void sintetizador_silenciar(void);
+
+ /**
+  * @brief Informa se alguma voz ainda soa
+  */
+ bool sintetizador_tocando(void);
+
+ /**
+  * @brief Gera as próximas amostras, mistura das vozes
+  *
+  * @param amostras Saída, de 0 a SINTETIZADOR_WRAP
+  * @param quantidade Número de amostras
+  */
+ void sintetizador_gerar(uint16_t *amostras, uint32_t quantidade);
+
+ /**
+  * @brief Começa a tocar pelo PWM do buzzer, com DMA (só no Pico)
+  *
+  * Configura o PWM do pino para SINTETIZADOR_WRAP sem divisor, pega dois
+  * canais de DMA que se revezam nos blocos e um timer de DMA para o ritmo.
+  * A CPU só entra uma vez por bloco, para gerar o próximo. Chama
+  * sintetizador_init com a taxa que o timer consegue de fato.
+  *
+  * @param pino Pino do buzzer
+  * @return false se não houver canal ou timer de DMA livre
+  */
+ bool sintetizador_iniciar_saida(uint pino);
+
+ #endif
@@ -0,0 +1,90 @@
+/**
+ * @file sintetizador_pwm.c
+ * @brief Saída do sintetizador no PWM do buzzer, por DMA
+ * @author Andre de Oliveira Melo
+ *
+ * Dois canais de DMA se revezam: enquanto um copia o seu bloco para o
+ * registrador de comparação do PWM, uma amostra a cada pedido do timer de
+ * DMA, a interrupção de fim do outro gera o bloco seguinte. Nenhuma
+ * interrupção por amostra.
+ */
+
+ #include "pico/stdlib.h"
+ #include "hardware/pwm.h"
+ #include "hardware/dma.h"
+ #include "hardware/irq.h"
+ #include "hardware/clocks.h"
+ #include "sintetizador.h"
+
+ static uint16_t blocos[2][SINTETIZADOR_BLOCO];
+ static int canais[2] = {-1, -1};
+
+ /**
+  * @brief Fim de um bloco: gera o próximo no lugar dele e rearma o canal
+  *
+  * O canal já foi disparado de novo pelo outro antes de esvaziar; aqui só
+  * o endereço de leitura volta ao início (a contagem é recarregada sozinha).
+  */
+ static void bloco_enviado(void) {
+     for (int i = 0; i < 2; i++) {
+         if (!dma_irqn_get_channel_status(1, canais[i])) {
+             continue;
+         }
+         dma_irqn_acknowledge_channel(1, canais[i]);
+         sintetizador_gerar(blocos[i], SINTETIZADOR_BLOCO);
+         dma_channel_set_read_addr(canais[i], blocos[i], false);
+     }
+ }
+
+ bool sintetizador_iniciar_saida(uint pino) {
+     int timer = dma_claim_unused_timer(false);
+     canais[0] = dma_claim_unused_channel(false);
+     canais[1] = dma_claim_unused_channel(false);
+
+     if (timer < 0 || canais[0] < 0 || canais[1] < 0) {
+         if (timer >= 0) {
+             dma_timer_unclaim(timer);
+         }
+         for (int i = 0; i < 2; i++) {
+             if (canais[i] >= 0) {
+                 dma_channel_unclaim(canais[i]);
+                 canais[i] = -1;
+             }
+         }
+         return false;
+     }
+
+     // Timer de DMA: clk_sys * 1 / divisor pedidos por segundo
+     uint32_t divisor = clock_get_hz(clk_sys) / SINTETIZADOR_TAXA;
+     dma_timer_set_fraction(timer, 1, divisor);
+     sintetizador_init(clock_get_hz(clk_sys) / divisor);
+
+     // Portadora de clk_sys / 256, bem acima do audível
+     gpio_set_function(pino, GPIO_FUNC_PWM);
+     uint slice = pwm_gpio_to_slice_num(pino);
+     pwm_config config = pwm_get_default_config();
+     pwm_config_set_clkdiv(&config, 1.0f);
+     pwm_config_set_wrap(&config, SINTETIZADOR_WRAP);
+     pwm_init(slice, &config, true);
+
+     for (int i = 0; i < 2; i++) {
+         sintetizador_gerar(blocos[i], SINTETIZADOR_BLOCO);
+
+         // Escrita de 16 bits no CC vale para os dois canais do slice (A e B)
+         dma_channel_config c = dma_channel_get_default_config(canais[i]);
+         channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+         channel_config_set_read_increment(&c, true);
+         channel_config_set_write_increment(&c, false);
+         channel_config_set_dreq(&c, dma_get_timer_dreq(timer));
+         channel_config_set_chain_to(&c, canais[!i]);
+         dma_channel_configure(canais[i], &c, &pwm_hw->slice[slice].cc, blocos[i], SINTETIZADOR_BLOCO, false);
+         dma_irqn_set_channel_enabled(1, canais[i], true);
+     }
+
+     // DMA_IRQ_0 é do display
+     irq_add_shared_handler(DMA_IRQ_1, bloco_enviado, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+     irq_set_enabled(DMA_IRQ_1, true);
+
+     dma_channel_start(canais[0]);
+     return true;
+ }
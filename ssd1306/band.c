@@ -0,0 +1,391 @@
+/**
+* @file band.c
+*
+* display lists rendered page by page into one band, each page sent (or
+* skipped, if its hash did not change) before the next one is drawn
+*/
+
+#include <pico/stdlib.h>
+#include <string.h>
+
+#include "band.h"
+
+inline static uint8_t page_of(int32_t y) {
+    return y<0?0:y>8*255?255:y>>3;
+}
+
+void ssd1306_dlist_init(ssd1306_dlist_t *l, ssd1306_op_t *ops, uint16_t size, uint16_t width, uint16_t height) {
+    l->ops=ops;
+    l->size=size;
+    l->count=0;
+    l->width=width;
+    l->height=height;
+}
+
+void ssd1306_dlist_reset(ssd1306_dlist_t *l) {
+    l->count=0;
+}
+
+// next free operation covering rows y0 to y1, NULL if the list is full
+static ssd1306_op_t *ssd1306_dlist_add(ssd1306_dlist_t *l, ssd1306_op_kind_t kind, int32_t y0, int32_t y1) {
+    if(l->count>=l->size)
+        return NULL;
+
+    ssd1306_op_t *op=&l->ops[l->count++];
+    op->kind=kind;
+    if(y1<0) {
+        op->page0=1; // entirely above the display, never rendered
+        op->page1=0;
+    } else {
+        op->page0=page_of(y0);
+        op->page1=page_of(y1);
+    }
+    return op;
+}
+
+static bool ssd1306_dlist_rect(ssd1306_dlist_t *l, ssd1306_op_kind_t kind, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    if(!width || !height)
+        return true;
+
+    if(x>INT16_MAX) x=INT16_MAX;
+    if(y>INT16_MAX) y=INT16_MAX;
+    if(width>UINT16_MAX) width=UINT16_MAX;
+    if(height>UINT16_MAX) height=UINT16_MAX;
+
+    ssd1306_op_t *op=ssd1306_dlist_add(l, kind, y, y+height-1);
+    if(!op)
+        return false;
+
+    op->x=x;
+    op->y=y;
+    op->rect.width=width;
+    op->rect.height=height;
+    return true;
+}
+
+bool ssd1306_dlist_fill_rect(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    return ssd1306_dlist_rect(l, SSD1306_OP_FILL_RECT, x, y, width, height);
+}
+
+bool ssd1306_dlist_clear_rect(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    return ssd1306_dlist_rect(l, SSD1306_OP_CLEAR_RECT, x, y, width, height);
+}
+
+bool ssd1306_dlist_invert_rect(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    return ssd1306_dlist_rect(l, SSD1306_OP_INVERT_RECT, x, y, width, height);
+}
+
+bool ssd1306_dlist_pixel(ssd1306_dlist_t *l, uint32_t x, uint32_t y) {
+    return ssd1306_dlist_rect(l, SSD1306_OP_FILL_RECT, x, y, 1, 1);
+}
+
+bool ssd1306_dlist_line(ssd1306_dlist_t *l, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    // clipped like ssd1306_draw_line, a line off the display is not stored
+    if(!ssd1306_clip_line(l->width, l->height, &x1, &y1, &x2, &y2))
+        return true;
+
+    ssd1306_op_t *op=ssd1306_dlist_add(l, SSD1306_OP_LINE, y1<y2?y1:y2, y1<y2?y2:y1);
+    if(!op)
+        return false;
+
+    op->x=x1;
+    op->y=y1;
+    op->line.x2=x2;
+    op->line.y2=y2;
+    return true;
+}
+
+bool ssd1306_dlist_string_with_font(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, const char *s) {
+    if(font[0]>8)
+        return false; // band_string takes one byte per glyph column
+    if(!scale || !*s)
+        return true;
+    if(scale>8)
+        scale=8;
+    if(x>INT16_MAX) x=INT16_MAX;
+    if(y>INT16_MAX) y=INT16_MAX;
+
+    ssd1306_op_t *op=ssd1306_dlist_add(l, SSD1306_OP_STRING, y, y+font[0]*scale-1);
+    if(!op)
+        return false;
+
+    op->x=x;
+    op->y=y;
+    op->text.font=font;
+    op->text.s=s;
+    op->text.scale=scale;
+    return true;
+}
+
+bool ssd1306_dlist_string(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t scale, const char *s) {
+    return ssd1306_dlist_string_with_font(l, x, y, scale, font_8x5, s);
+}
+
+bool ssd1306_dlist_atlas_char(ssd1306_dlist_t *l, const ssd1306_atlas_t *a, uint32_t x, uint32_t page, char c) {
+    if(page>255)
+        page=255;
+    if(x>INT16_MAX) x=INT16_MAX;
+
+    ssd1306_op_t *op=ssd1306_dlist_add(l, SSD1306_OP_ATLAS_CHAR, 8*page, 8*(page+a->pages)-1);
+    if(!op)
+        return false;
+
+    op->x=x;
+    op->y=page;
+    op->glyph.atlas=a;
+    op->glyph.c=c;
+    return true;
+}
+
+bool ssd1306_band_init(ssd1306_band_t *b, uint16_t width, uint16_t height, bool external_vcc, ssd1306_transport_t *transport) {
+    if(!width || width>SSD1306_BAND_MAX_WIDTH || !height || height%8 || height/8>SSD1306_MAX_PAGES)
+        return false;
+
+    b->width=width;
+    b->height=height;
+    b->pages=height/8;
+    b->transport=transport;
+    b->valid=false;
+    memset(&b->stats, 0, sizeof(b->stats));
+
+    const uint8_t cmds[]= {SSD1306_INIT_SEQUENCE(width, height, external_vcc)};
+
+    const uint32_t start=time_us_32();
+    ++b->stats.transactions;
+    ssd1306_transport_write_cmds(transport, cmds, sizeof(cmds));
+    b->stats.init_us=time_us_32()-start;
+
+    return true;
+}
+
+void ssd1306_band_invalidate(ssd1306_band_t *b) {
+    b->valid=false;
+}
+
+// rows of page covered by rows y0 to y1, 0 if none
+inline static uint8_t band_mask(int32_t page, int32_t y0, int32_t y1) {
+    const int32_t top=page*8;
+
+    if(y1<top || y0>top+7)
+        return 0;
+    if(y0<top) y0=top;
+    if(y1>top+7) y1=top+7;
+
+    return (0xFF<<(y0-top))&(0xFF>>(top+7-y1));
+}
+
+static void band_rect(ssd1306_band_t *b, const ssd1306_op_t *op, uint8_t page) {
+    const uint8_t mask=band_mask(page, op->y, op->y+op->rect.height-1);
+    if(!mask || op->x>=b->width)
+        return;
+
+    uint8_t *dst=b->band+1;
+    const int32_t end=op->x+op->rect.width>b->width?b->width:op->x+op->rect.width;
+
+    for(int32_t x=op->x; x<end; ++x) {
+        if(op->kind==SSD1306_OP_FILL_RECT)
+            dst[x]|=mask;
+        else if(op->kind==SSD1306_OP_CLEAR_RECT)
+            dst[x]&=~mask;
+        else
+            dst[x]^=mask;
+    }
+}
+
+/**
+*	same steps as ssd1306_draw_line, so both renderers agree on every pixel.
+*	after k steps along the major axis the bresenham error is
+*	major/2-k*minor+n*major for the n minor steps taken so far, always in
+*	0..major-1; that gives n for any k, and the first k of any n, so the
+*	walk starts at the first pixel of the band instead of the line start.
+*/
+static void band_line(ssd1306_band_t *b, const ssd1306_op_t *op, uint8_t page) {
+    int32_t x1=op->x, y1=op->y, x2=op->line.x2, y2=op->line.y2;
+    const int32_t dx=x2>x1?x2-x1:x1-x2;
+    const int32_t dy=y2>y1?y2-y1:y1-y2;
+    const int32_t top=8*page;
+    uint8_t *dst=b->band+1;
+
+    if(dx>=dy) {
+        if(x1>x2) {
+            const int32_t tx=x1, ty=y1;
+            x1=x2;
+            y1=y2;
+            x2=tx;
+            y2=ty;
+        }
+
+        // rows of the band as minor steps n0..n1 from y1
+        const int32_t sy=y1<y2?1:-1;
+        int32_t n=sy>0?top-y1:y1-(top+7);
+        const int32_t n1=sy>0?top+7-y1:y1-top;
+        if(n<0)
+            n=0;
+        if(n>dy || n1<0)
+            return;
+
+        const int32_t k=n?(dx/2+(n-1)*dx)/dy+1:0;
+        int32_t err=dx/2-k*dy+n*dx;
+
+        for(int32_t x=x1+k; x<=x2 && x<b->width && n<=n1; ++x) {
+            dst[x]|=1<<((y1+sy*n)&7);
+            err-=dy;
+            if(err<0) {
+                ++n;
+                err+=dx;
+            }
+        }
+    } else {
+        if(y1>y2) {
+            const int32_t tx=x1, ty=y1;
+            x1=x2;
+            y1=y2;
+            x2=tx;
+            y2=ty;
+        }
+
+        // first row of the band on the line
+        const int32_t k=top>y1?top-y1:0;
+        if(y1+k>y2)
+            return;
+
+        const int32_t sx=x1<x2?1:-1;
+        int32_t n=(k*dx-dy/2+dy-1)/dy;
+        int32_t err=dy/2-k*dx+n*dy;
+
+        for(int32_t y=y1+k; y<=y2 && y<top+8; ++y) {
+            if(x1+sx*n<b->width) // a list drawn for a wider display
+                dst[x1+sx*n]|=1<<(y&7);
+            err-=dx;
+            if(err<0) {
+                ++n;
+                err+=dy;
+            }
+        }
+    }
+}
+
+static void band_string(ssd1306_band_t *b, const ssd1306_op_t *op, uint8_t page) {
+    const uint8_t *font=op->text.font;
+    const uint32_t scale=op->text.scale;
+    const int32_t shift=op->y-8*page;	// position of glyph row 0 within the page
+    const uint64_t rows=font[0]*scale>=64?UINT64_MAX:(1ull<<(font[0]*scale))-1;
+    uint8_t *dst=b->band+1;
+    int32_t x=op->x;
+
+    for(const char *s=op->text.s; *s && x<b->width; ++s, x+=(font[1]+font[2])*scale) {
+        if((uint8_t) *s<font[3] || (uint8_t) *s>font[4])
+            continue;
+
+        const uint8_t *glyph=&font[((uint8_t) *s-font[3])*font[1]+5];
+
+        for(uint32_t w=0; w<font[1]; ++w) {
+            // the glyph column stretched to scale rows per bit
+            uint64_t column=0;
+            for(uint32_t bit=0; bit<8; ++bit)
+                if(glyph[w]>>bit&1)
+                    column|=((1ull<<scale)-1)<<(bit*scale);
+            column&=rows;
+
+            uint8_t slice;
+            if(shift>=0)
+                slice=shift<8?(uint8_t) (column<<shift):0;
+            else
+                slice=-shift<64?(uint8_t) (column>>-shift):0;
+            if(!slice)
+                continue;
+
+            for(uint32_t i=0; i<scale; ++i) {
+                const int32_t col=x+w*scale+i;
+                if(col>=0 && col<b->width)
+                    dst[col]|=slice;
+            }
+        }
+    }
+}
+
+static void band_atlas_char(ssd1306_band_t *b, const ssd1306_op_t *op, uint8_t page) {
+    const ssd1306_atlas_t *a=op->glyph.atlas;
+    const uint8_t c=op->glyph.c;
+
+    if(c<a->first || c>=a->first+a->count)
+        return;
+
+    const uint32_t i=page-op->y;
+    const uint8_t *src=a->data+((c-a->first)*a->pages+i)*a->width;
+    const uint8_t keep=~a->mask[i];
+    uint8_t *dst=b->band+1;
+
+    for(uint32_t w=0; w<a->width && op->x+w<b->width; ++w)
+        dst[op->x+w]=(dst[op->x+w]&keep)|src[w];
+}
+
+// FNV-1a, only used to notice that a page did not change
+static uint32_t band_hash(const uint8_t *data, size_t len) {
+    uint32_t h=2166136261u;
+
+    while(len--)
+        h=(h^*data++)*16777619u;
+    return h;
+}
+
+void ssd1306_band_render(ssd1306_band_t *b, const ssd1306_dlist_t *l) {
+    ssd1306_transport_t *t=b->transport;
+    uint8_t *band=b->band+1;
+    bool window=false; // the address pointer is at the start of this page
+    size_t sent=0;
+
+    for(uint8_t page=0; page<b->pages; ++page) {
+        memset(band, 0, b->width);
+
+        for(const ssd1306_op_t *op=l->ops; op<l->ops+l->count; ++op) {
+            if(page<op->page0 || page>op->page1)
+                continue;
+
+            switch(op->kind) {
+            case SSD1306_OP_LINE:
+                band_line(b, op, page);
+                break;
+            case SSD1306_OP_STRING:
+                band_string(b, op, page);
+                break;
+            case SSD1306_OP_ATLAS_CHAR:
+                band_atlas_char(b, op, page);
+                break;
+            default:
+                band_rect(b, op, page);
+                break;
+            }
+        }
+
+        const uint32_t h=band_hash(band, b->width);
+        if(b->valid && h==b->page_hash[page]) {
+            window=false;
+            continue;
+        }
+        b->page_hash[page]=h;
+
+        if(!window) {
+            uint8_t cmds[SSD1306_WINDOW_CMDS];
+            ssd1306_window_commands(cmds, b->width, 0, b->width-1, page, b->pages-1);
+            ++b->stats.transactions;
+            ssd1306_transport_write_cmds(t, cmds, sizeof(cmds));
+            window=true;
+        }
+
+        ++b->stats.transactions;
+        ssd1306_transport_write_data(t, band, b->width);
+        sent+=b->width;
+    }
+
+    b->valid=true;
+
+    const size_t total=b->pages*b->width;
+    ++b->stats.flushes;
+    if(!sent)
+        ++b->stats.skipped;
+    b->stats.bytes_sent+=sent;
+    b->stats.bytes_saved+=total-sent;
+    b->stats.last_bytes_sent=sent;
+    b->stats.last_bytes_saved=total-sent;
+}
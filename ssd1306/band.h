@@ -0,0 +1,229 @@
+/**
+* @file band.h
+*
+* band renderer: the screen is described as a list of draw operations and
+* rendered one page at a time into a single page sized band, which is sent
+* before the next page is rendered. no framebuffer is needed.
+*/
+
+#ifndef _inc_ssd1306_band
+#define _inc_ssd1306_band
+#include <pico/stdlib.h>
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief widest display supported by the band renderer
+*/
+#define SSD1306_BAND_MAX_WIDTH 128
+
+typedef enum {
+    SSD1306_OP_FILL_RECT,
+    SSD1306_OP_CLEAR_RECT,
+    SSD1306_OP_INVERT_RECT,
+    SSD1306_OP_LINE,
+    SSD1306_OP_STRING,
+    SSD1306_OP_ATLAS_CHAR
+} ssd1306_op_kind_t;
+
+/**
+*	@brief one draw operation of a display list
+*/
+typedef struct {
+    uint8_t kind;		/**< ssd1306_op_kind_t */
+    uint8_t page0;		/**< first page touched */
+    uint8_t page1;		/**< last page touched */
+    int16_t x;			/**< left column, or first point of a line (clipped to the display) */
+    int16_t y;			/**< top row, or first point of a line; page of an atlas char */
+    union {
+        struct {
+            uint16_t width;
+            uint16_t height;
+        } rect;
+        struct {
+            int16_t x2;
+            int16_t y2;
+        } line;
+        struct {
+            const uint8_t *font;
+            const char *s;		/**< not copied, must stay valid until rendered */
+            uint8_t scale;
+        } text;
+        struct {
+            const ssd1306_atlas_t *atlas;
+            char c;
+        } glyph;
+    };
+} ssd1306_op_t;
+
+/**
+*	@brief list of draw operations, applied in order
+*/
+typedef struct {
+    ssd1306_op_t *ops;	/**< operation storage */
+    uint16_t size;		/**< capacity of ops */
+    uint16_t count;		/**< operations in the list */
+    uint16_t width;		/**< width of the display the list is drawn on */
+    uint16_t height;	/**< height of the display the list is drawn on */
+} ssd1306_dlist_t;
+
+/**
+*	@brief renderer state, the only display memory needed
+*/
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t pages;
+    ssd1306_transport_t *transport;
+    bool valid;			/**< page_hash describes what the display shows */
+    uint32_t page_hash[SSD1306_MAX_PAGES];	/**< hash of every page sent, pages that hash the same are skipped */
+    ssd1306_stats_t stats;	/**< flush statistics */
+    uint8_t band[SSD1306_BAND_MAX_WIDTH+1];	/**< one page, band[0] is scratch for the transport */
+} ssd1306_band_t;
+
+/**
+*	@brief initialize a display list
+*
+*	@param[out] l : display list
+*	@param[in] ops : storage for the operations
+*	@param[in] size : number of operations ops can hold
+*	@param[in] width : width of the display the list is drawn on, lines are clipped to it
+*	@param[in] height : height of the display
+*/
+void ssd1306_dlist_init(ssd1306_dlist_t *l, ssd1306_op_t *ops, uint16_t size, uint16_t width, uint16_t height);
+
+/**
+*	@brief remove every operation from a display list
+*
+*	@param[in] l : display list
+*/
+void ssd1306_dlist_reset(ssd1306_dlist_t *l);
+
+/**
+*	@brief append a filled rectangle
+*
+*	the ssd1306_dlist_* calls take the same arguments as the framebuffer
+*	calls of the same name and return false when the list is full.
+*
+*	@param[in] l : display list
+*	@param[in] x : x position of left corner
+*	@param[in] y : y position of top corner
+*	@param[in] width : width of rectangle
+*	@param[in] height : height of rectangle
+*
+*	@return false if the list is full
+*/
+bool ssd1306_dlist_fill_rect(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/**
+*	@brief append a cleared rectangle, see ssd1306_dlist_fill_rect
+*/
+bool ssd1306_dlist_clear_rect(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/**
+*	@brief append an inverted rectangle, see ssd1306_dlist_fill_rect
+*/
+bool ssd1306_dlist_invert_rect(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/**
+*	@brief append a pixel
+*
+*	@param[in] l : display list
+*	@param[in] x : x position
+*	@param[in] y : y position
+*
+*	@return false if the list is full
+*/
+bool ssd1306_dlist_pixel(ssd1306_dlist_t *l, uint32_t x, uint32_t y);
+
+/**
+*	@brief append a line
+*
+*	@param[in] l : display list
+*	@param[in] x1 : x position of starting point
+*	@param[in] y1 : y position of starting point
+*	@param[in] x2 : x position of end point
+*	@param[in] y2 : y position of end point
+*
+*	@return false if the list is full
+*/
+bool ssd1306_dlist_line(ssd1306_dlist_t *l, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+
+/**
+*	@brief append a string drawn with a custom font
+*
+*	only fonts up to 8 pixels high are supported, one byte per glyph
+*	column; taller fonts are rejected.
+*
+*	@param[in] l : display list
+*	@param[in] x : x starting position of text
+*	@param[in] y : y starting position of text
+*	@param[in] scale : scale font to n times of original size (1 to 8)
+*	@param[in] font : pointer to font
+*	@param[in] s : text, must stay valid until the list is rendered
+*
+*	@return false if the list is full or the font is taller than 8 pixels
+*/
+bool ssd1306_dlist_string_with_font(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, const char *s);
+
+/**
+*	@brief append a string drawn with the builtin font
+*
+*	@return false if the list is full
+*/
+bool ssd1306_dlist_string(ssd1306_dlist_t *l, uint32_t x, uint32_t y, uint32_t scale, const char *s);
+
+/**
+*	@brief append a pre-rendered glyph, see ssd1306_atlas_draw_char
+*
+*	@param[in] l : display list
+*	@param[in] a : atlas, must stay valid until the list is rendered
+*	@param[in] x : x position of the glyph
+*	@param[in] page : page of the first glyph row
+*	@param[in] c : character
+*
+*	@return false if the list is full
+*/
+bool ssd1306_dlist_atlas_char(ssd1306_dlist_t *l, const ssd1306_atlas_t *a, uint32_t x, uint32_t page, char c);
+
+/**
+*	@brief initialize a display for band rendering and send the init sequence
+*
+*	@param[out] b : renderer
+*	@param[in] width : width of display, at most SSD1306_BAND_MAX_WIDTH
+*	@param[in] height : height of display
+*	@param[in] external_vcc : display powered by an external supply
+*	@param[in] transport : bus the display is attached to
+*
+*	@return false on unsupported geometry
+*/
+bool ssd1306_band_init(ssd1306_band_t *b, uint16_t width, uint16_t height, bool external_vcc, ssd1306_transport_t *transport);
+
+/**
+*	@brief render a display list and send it, one page at a time
+*
+*	pages that hash the same as the last time they were sent are skipped.
+*	only the 32 bit hash of each page is kept, not its bytes, so a changed
+*	page that collides with the old hash (about one in 2^32) stays stale on
+*	the panel until it changes again or ssd1306_band_invalidate is called.
+*
+*	@param[in] b : renderer
+*	@param[in] l : display list
+*/
+void ssd1306_band_render(ssd1306_band_t *b, const ssd1306_dlist_t *l);
+
+/**
+*	@brief forget what the display shows, the next render sends every page
+*
+*	@param[in] b : renderer
+*/
+void ssd1306_band_invalidate(ssd1306_band_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
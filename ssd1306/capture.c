@@ -0,0 +1,135 @@
+/**
+* @file capture.c
+*
+* capture tap: frame differences, run length compressed into packets
+*/
+
+#include <pico/stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+
+// compress src into dst, same format as the images, returns the bytes written
+static size_t ssd1306_capture_rle(const uint8_t *src, size_t len, uint8_t *dst) {
+    size_t out=0, lit=0, lit_len=0;
+
+    for(size_t i=0; i<len;) {
+        size_t run=1;
+        while(i+run<len && src[i+run]==src[i] && run<129)
+            ++run;
+
+        // a run of two inside literals costs as much as the literals, keep it literal
+        if(run>2 || (run==2 && !lit_len)) {
+            if(lit_len) {
+                dst[out++]=lit_len-1;
+                memcpy(dst+out, src+lit, lit_len);
+                out+=lit_len;
+                lit_len=0;
+            }
+            dst[out++]=0x80|(run-2);
+            dst[out++]=src[i];
+            i+=run;
+            continue;
+        }
+
+        if(!lit_len)
+            lit=i;
+        ++i;
+        if(++lit_len==128) {
+            dst[out++]=lit_len-1;
+            memcpy(dst+out, src+lit, lit_len);
+            out+=lit_len;
+            lit_len=0;
+        }
+    }
+
+    if(lit_len) {
+        dst[out++]=lit_len-1;
+        memcpy(dst+out, src+lit, lit_len);
+        out+=lit_len;
+    }
+
+    return out;
+}
+
+void ssd1306_capture_attach(ssd1306_capture_t *c, ssd1306_t *p, ssd1306_capture_write_t write, void *ctx) {
+    c->write=write;
+    c->write_ctx=ctx;
+    c->seq=0;
+    c->key=true;
+    c->frames=c->unchanged=c->bytes=0;
+    p->capture=c;
+}
+
+void ssd1306_capture_detach(ssd1306_t *p) {
+    p->capture=NULL;
+}
+
+void ssd1306_capture_key(ssd1306_capture_t *c) {
+    c->key=true;
+}
+
+// capture frame, page format in the geometry of p
+static void ssd1306_capture_diff(ssd1306_capture_t *c, const ssd1306_t *p, const uint8_t *frame) {
+    const size_t size=p->pages*p->width;
+    const bool key=c->key || c->seq%SSD1306_CAPTURE_KEY_EVERY==0;
+
+    ++c->frames;
+
+    // the difference is built in place of the previous frame
+    bool changed=false;
+    if(key)
+        memset(c->prev, 0, size);
+    for(size_t i=0; i<size; ++i) {
+        c->prev[i]^=frame[i];
+        changed|=c->prev[i];
+    }
+
+    if(!changed && !key) {
+        memcpy(c->prev, frame, size);
+        ++c->unchanged;
+        return;
+    }
+
+    uint8_t *h=c->packet;
+    const size_t len=ssd1306_capture_rle(c->prev, size, h+SSD1306_CAPTURE_HEADER);
+    const uint32_t now=time_us_32();
+
+    h[0]=0xA5;
+    h[1]=0x5A;
+    h[2]=key?'K':'D';
+    h[3]=p->width;
+    h[4]=p->height;
+    h[5]=c->seq;
+    h[6]=c->seq>>8;
+    h[7]=now;
+    h[8]=now>>8;
+    h[9]=now>>16;
+    h[10]=now>>24;
+    h[11]=len;
+    h[12]=len>>8;
+
+    uint8_t check=0;
+    for(size_t i=2; i<SSD1306_CAPTURE_HEADER+len; ++i)
+        check^=h[i];
+    h[SSD1306_CAPTURE_HEADER+len]=check;
+
+    memcpy(c->prev, frame, size);
+    c->key=false;
+    ++c->seq;
+    c->bytes+=SSD1306_CAPTURE_HEADER+len+1;
+    c->write(c->write_ctx, h, SSD1306_CAPTURE_HEADER+len+1);
+}
+
+void ssd1306_capture_frame(ssd1306_capture_t *c, const ssd1306_t *p) {
+    ssd1306_capture_diff(c, p, p->buffer);
+}
+
+uint8_t *ssd1306_capture_frame_begin(ssd1306_capture_t *c, const ssd1306_t *p) {
+    memcpy(c->frame, c->prev, p->pages*p->width);
+    return c->frame;
+}
+
+void ssd1306_capture_frame_end(ssd1306_capture_t *c, const ssd1306_t *p) {
+    ssd1306_capture_diff(c, p, c->frame);
+}
@@ -0,0 +1,136 @@
+/**
+* @file capture.h
+*
+* capture tap: every frame ssd1306_show, ssd1306_show_async or
+* ssd1306_show_span sends, or ssd1306_image_send puts over the last one,
+* is xored with the previous captured frame and the difference goes out
+* run length compressed, for tools/ssd1306_capture.py to rebuild. a flush
+* with nothing dirty is not captured at all, a moving cursor costs a few
+* bytes. while a gray.h layer
+* owns the display, ssd1306_gray_commit feeds the tap instead, with the
+* 1-bit framebuffer the planes were taken from.
+*
+* built only with SSD1306_CAPTURE defined; without it the driver has no
+* trace of the tap, with it an idle tap is one pointer test per flush.
+*
+* packet, little endian:
+*   0xA5 0x5A        sync
+*   type             'K' key frame (xored with a blank screen) or 'D' delta
+*   width, height    panel size
+*   seq (2)          packet counter, a gap means deltas were lost
+*   time (4)         time_us_32 of the flush
+*   len (2)          bytes of payload
+*   payload          compressed framebuffer difference, page format
+*   check            xor of every byte from type to the end of payload
+*
+* the payload uses the format of ssd1306/image.h:
+*   c&0x80 : the next byte repeated (c&0x7f)+2 times
+*   else   : the next c+1 bytes as they are
+*/
+
+#ifndef _inc_ssd1306_capture
+#define _inc_ssd1306_capture
+#include <pico/stdlib.h>
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief a key frame every this many packets, so a reader can join late
+*/
+#ifndef SSD1306_CAPTURE_KEY_EVERY
+#define SSD1306_CAPTURE_KEY_EVERY 64
+#endif
+
+/**
+*	@brief bytes of a packet before the payload
+*/
+#define SSD1306_CAPTURE_HEADER 13
+
+/**
+*	@brief largest packet: the compressed data never grows past 4/3 of the frame
+*/
+#define SSD1306_CAPTURE_PACKET_MAX (SSD1306_CAPTURE_HEADER+SSD1306_MAX_PAGES*128*3/2+1)
+
+/**
+*	@brief sends a packet, e.g. over usb cdc without newline translation
+*/
+typedef void (*ssd1306_capture_write_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+*	@brief capture tap state
+*/
+typedef struct ssd1306_capture {
+    ssd1306_capture_write_t write;	/**< output of the packets */
+    void *write_ctx;		/**< first argument of write */
+    uint16_t seq;			/**< number of the next packet */
+    bool key;				/**< next packet is a key frame */
+    uint32_t frames;		/**< flushes captured, flushes with nothing dirty are skipped */
+    uint32_t unchanged;		/**< captured flushes whose frame matched the previous one, nothing sent */
+    uint32_t bytes;			/**< bytes written */
+    uint8_t prev[SSD1306_MAX_PAGES*128];	/**< last captured frame */
+    uint8_t frame[SSD1306_MAX_PAGES*128];	/**< frame sent around the framebuffer, see ssd1306_capture_frame_begin */
+    uint8_t packet[SSD1306_CAPTURE_PACKET_MAX];	/**< packet being built */
+} ssd1306_capture_t;
+
+/**
+*	@brief attach a capture tap to a display, the first packet is a key frame
+*
+*	@param[out] c : capture tap
+*	@param[in] p : instance of display
+*	@param[in] write : output of the packets
+*	@param[in] ctx : first argument of write
+*/
+void ssd1306_capture_attach(ssd1306_capture_t *c, ssd1306_t *p, ssd1306_capture_write_t write, void *ctx);
+
+/**
+*	@brief detach the capture tap of a display
+*
+*	@param[in] p : instance of display
+*/
+void ssd1306_capture_detach(ssd1306_t *p);
+
+/**
+*	@brief make the next packet a key frame
+*
+*	@param[in] c : capture tap
+*/
+void ssd1306_capture_key(ssd1306_capture_t *c);
+
+/**
+*	@brief capture the framebuffer of a display, called by the driver on every flush
+*
+*	@param[in] c : capture tap
+*	@param[in] p : instance of display
+*/
+void ssd1306_capture_frame(ssd1306_capture_t *c, const ssd1306_t *p);
+
+/**
+*	@brief start capturing data sent straight to the display, around the framebuffer
+*
+*	the frame returned holds the last captured frame; the caller copies
+*	what it sends into it, page format, and ends with
+*	ssd1306_capture_frame_end.
+*
+*	@param[in] c : capture tap
+*	@param[in] p : instance of display
+*
+*	@return frame to update
+*/
+uint8_t *ssd1306_capture_frame_begin(ssd1306_capture_t *c, const ssd1306_t *p);
+
+/**
+*	@brief capture the frame of ssd1306_capture_frame_begin
+*
+*	@param[in] c : capture tap
+*	@param[in] p : instance of display
+*/
+void ssd1306_capture_frame_end(ssd1306_capture_t *c, const ssd1306_t *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
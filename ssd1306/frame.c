@@ -0,0 +1,84 @@
+/**
+* @file frame.c
+*
+* frame scheduler: at most one async flush per frame period, with the
+* time from commit to the end of the flush in its stats
+*/
+
+#include <pico/stdlib.h>
+#include <string.h>
+
+#include "frame.h"
+
+void ssd1306_frame_init(ssd1306_frame_t *f, ssd1306_t *p, uint32_t fps) {
+    f->disp=p;
+    f->next_us=time_us_64();
+    f->commit_us=0;
+    memset(&f->stats, 0, sizeof(f->stats));
+    ssd1306_frame_set_fps(f, fps);
+}
+
+void ssd1306_frame_set_fps(ssd1306_frame_t *f, uint32_t fps) {
+    f->period_us=1000000/(fps?fps:1);
+}
+
+// flush callback, may run in interrupt context
+static void ssd1306_frame_done(ssd1306_t *p, void *ctx) {
+    ssd1306_frame_t *f=ctx;
+    ssd1306_frame_stats_t *s=&f->stats;
+    const uint32_t us=time_us_64()-f->commit_us;
+
+    (void) p;
+    s->last_us=us;
+    if(us>s->max_us)
+        s->max_us=us;
+    if(us>f->period_us)
+        ++s->over_budget;
+    s->total_us+=us;
+}
+
+bool ssd1306_frame_present(ssd1306_frame_t *f) {
+    ssd1306_t *p=f->disp;
+
+    if(p->scrolling || !ssd1306_is_dirty(p)) {
+        ++f->stats.idle;
+        return false;
+    }
+
+    ssd1306_show_wait(p); // the previous frame, before its commit time is overwritten
+    ++f->stats.frames;
+    f->commit_us=time_us_64();
+    ssd1306_show_async(p, ssd1306_frame_done, f);
+
+    return true;
+}
+
+bool ssd1306_frame_tick(ssd1306_frame_t *f) {
+    const uint64_t now=time_us_64();
+
+    if(now<f->next_us)
+        return false;
+
+    // keep to the grid so the rate does not drift, unless a whole period was missed
+    if(now-f->next_us>=f->period_us) {
+        ++f->stats.late;
+        f->next_us=now+f->period_us;
+    } else {
+        f->next_us+=f->period_us;
+    }
+
+    return ssd1306_frame_present(f);
+}
+
+bool ssd1306_frame_wait(ssd1306_frame_t *f) {
+    const uint64_t now=time_us_64();
+
+    if(now<f->next_us)
+        sleep_us(f->next_us-now);
+
+    return ssd1306_frame_tick(f);
+}
+
+const ssd1306_frame_stats_t *ssd1306_frame_stats(const ssd1306_frame_t *f) {
+    return &f->stats;
+}
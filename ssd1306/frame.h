@@ -0,0 +1,110 @@
+/**
+* @file frame.h
+*
+* frame scheduler: drawing only changes the framebuffer and its dirty
+* ranges, the scheduler sends everything that changed as one async flush
+* per frame, at a fixed frame rate or when asked to.
+*/
+
+#ifndef _inc_ssd1306_frame
+#define _inc_ssd1306_frame
+#include <pico/stdlib.h>
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief frame statistics, see ssd1306_frame_stats
+*
+*	the frame time runs from the commit of a frame to the end of its flush
+*	on the bus.
+*/
+typedef struct {
+    uint32_t frames;		/**< frames sent */
+    uint32_t idle;			/**< due frames with nothing to send */
+    uint32_t late;			/**< frames that came more than a period after they were due */
+    uint32_t over_budget;	/**< frames that took longer than a period to send */
+    uint32_t last_us;		/**< frame time of the last frame */
+    uint32_t max_us;		/**< longest frame time */
+    uint64_t total_us;		/**< sum of all frame times */
+} ssd1306_frame_stats_t;
+
+/**
+*	@brief frame scheduler of a display
+*/
+typedef struct {
+    ssd1306_t *disp;		/**< display the frames go to */
+    uint32_t period_us;		/**< time between two frames */
+    uint64_t next_us;		/**< time_us_64 at which the next frame is due */
+    volatile uint64_t commit_us;	/**< time the frame on the bus was committed */
+    ssd1306_frame_stats_t stats;	/**< frame statistics */
+} ssd1306_frame_t;
+
+/**
+*	@brief set up a frame scheduler, the first frame is due at once
+*
+*	@param[out] f : frame scheduler
+*	@param[in] p : instance of display
+*	@param[in] fps : target frame rate, at least 1
+*/
+void ssd1306_frame_init(ssd1306_frame_t *f, ssd1306_t *p, uint32_t fps);
+
+/**
+*	@brief change the target frame rate
+*
+*	@param[in] f : frame scheduler
+*	@param[in] fps : target frame rate, at least 1
+*/
+void ssd1306_frame_set_fps(ssd1306_frame_t *f, uint32_t fps);
+
+/**
+*	@brief send the frame if it is due
+*
+*	does not wait. frames keep to a fixed grid, a frame that comes more
+*	than a period late starts a new grid and is counted as late.
+*
+*	@param[in] f : frame scheduler
+*
+*	@return true if a frame was committed
+*/
+bool ssd1306_frame_tick(ssd1306_frame_t *f);
+
+/**
+*	@brief send everything drawn so far now, as one async flush
+*
+*	waits for the previous frame if it is still on the bus. nothing is
+*	sent while the display scrolls in hardware.
+*
+*	@param[in] f : frame scheduler
+*
+*	@return true if a frame was committed, false if nothing had changed
+*/
+bool ssd1306_frame_present(ssd1306_frame_t *f);
+
+/**
+*	@brief sleep until the next frame is due and send it
+*
+*	paces a main loop at the target frame rate.
+*
+*	@param[in] f : frame scheduler
+*
+*	@return true if a frame was committed
+*/
+bool ssd1306_frame_wait(ssd1306_frame_t *f);
+
+/**
+*	@brief get frame statistics
+*
+*	@param[in] f : frame scheduler
+*
+*	@return statistics, valid as long as f
+*/
+const ssd1306_frame_stats_t *ssd1306_frame_stats(const ssd1306_frame_t *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
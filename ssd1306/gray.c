@@ -0,0 +1,278 @@
+/**
+* @file gray.c
+*
+* grayscale layer: bit-planes, their commit and the plane loop
+*/
+
+#include <pico/stdlib.h>
+#include "hardware/sync.h"
+#include <string.h>
+
+#include "gray.h"
+#ifdef SSD1306_CAPTURE
+#include "capture.h"
+#endif
+
+// plane shown in each slot of the cycle: high, high, low
+static const uint8_t ssd1306_gray_cycle[SSD1306_GRAY_CYCLE]= {1, 1, 0};
+
+inline static void ssd1306_gray_window_clear(ssd1306_gray_window_t *w) {
+    w->x0=w->page0=0xff;
+    w->x1=w->page1=0;
+}
+
+inline static bool ssd1306_gray_window_empty(const ssd1306_gray_window_t *w) {
+    return w->x0>w->x1;
+}
+
+inline static void ssd1306_gray_window_add(ssd1306_gray_window_t *w, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+    if(x0<w->x0)
+        w->x0=x0;
+    if(x1>w->x1)
+        w->x1=x1;
+    if(page0<w->page0)
+        w->page0=page0;
+    if(page1>w->page1)
+        w->page1=page1;
+}
+
+inline static void ssd1306_gray_window_union(ssd1306_gray_window_t *w, const ssd1306_gray_window_t *o) {
+    if(!ssd1306_gray_window_empty(o))
+        ssd1306_gray_window_add(w, o->x0, o->x1, o->page0, o->page1);
+}
+
+// window around the bytes where a and b differ
+static void ssd1306_gray_compare(const ssd1306_t *p, const uint8_t *a, const uint8_t *b, ssd1306_gray_window_t *w) {
+    ssd1306_gray_window_clear(w);
+    for(uint8_t page=0; page<p->pages; ++page) {
+        const uint8_t *ra=a+page*p->width, *rb=b+page*p->width;
+
+        for(uint8_t x=0; x<p->width; ++x)
+            if(ra[x]!=rb[x])
+                ssd1306_gray_window_add(w, x, x, page, page);
+    }
+}
+
+/**
+*	applies level to the rows of mask in columns x0..x0+width-1 of one
+*	page. src gives the pixels that get level, the others get 0; NULL
+*	gives them all level.
+*/
+static void ssd1306_gray_page(ssd1306_gray_t *g, uint32_t page, uint32_t x0, uint32_t width, uint8_t mask, const uint8_t *src, uint8_t level) {
+    const size_t at=page*g->disp->width+x0;
+
+    for(uint8_t plane=0; plane<2; ++plane) {
+        uint8_t *dst=g->back[plane]+at;
+        const bool on=level>>plane&1;
+
+        for(uint32_t i=0; i<width; ++i) {
+            const uint8_t lit=on?(src?src[i]:0xff)&mask:0;
+            dst[i]=(dst[i]&~mask)|lit;
+        }
+    }
+}
+
+static void ssd1306_gray_rect(ssd1306_gray_t *g, uint32_t x, uint32_t y, uint32_t width, uint32_t height, bool from_mono, uint8_t level) {
+    const ssd1306_t *p=g->disp;
+
+    if(x>=p->width || y>=p->height || !width || !height)
+        return;
+    if(width>p->width-x)
+        width=p->width-x;
+    if(height>p->height-y)
+        height=p->height-y;
+    if(level>SSD1306_GRAY_MAX)
+        level=SSD1306_GRAY_MAX;
+
+    const uint32_t y1=y+height-1;
+    for(uint32_t page=y>>3; page<=y1>>3; ++page) {
+        const uint32_t top=page==y>>3?y&7:0;
+        const uint32_t bottom=page==y1>>3?y1&7:7;
+        const uint8_t mask=(0xff<<top)&(0xff>>(7-bottom));
+
+        ssd1306_gray_page(g, page, x, width, mask, from_mono?p->buffer+page*p->width+x:NULL, level);
+    }
+}
+
+void ssd1306_gray_init(ssd1306_gray_t *g, ssd1306_t *p) {
+    memset(g, 0, sizeof(*g));
+    g->disp=p;
+    ssd1306_gray_window_clear(&g->differ);
+    ssd1306_gray_window_clear(&g->changed);
+    g->shown=-1;
+}
+
+void ssd1306_gray_pixel(ssd1306_gray_t *g, uint32_t x, uint32_t y, uint8_t level) {
+    ssd1306_gray_rect(g, x, y, 1, 1, false, level);
+}
+
+void ssd1306_gray_fill_rect(ssd1306_gray_t *g, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t level) {
+    ssd1306_gray_rect(g, x, y, width, height, false, level);
+}
+
+void ssd1306_gray_from_mono(ssd1306_gray_t *g, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t level) {
+    ssd1306_gray_rect(g, x, y, width, height, true, level);
+}
+
+void ssd1306_gray_commit(ssd1306_gray_t *g) {
+    ssd1306_t *p=g->disp;
+    const size_t size=p->pages*p->width;
+    ssd1306_gray_window_t changed, changed_high, differ;
+
+    ssd1306_gray_compare(p, g->back[0], g->front[0], &changed);
+    ssd1306_gray_compare(p, g->back[1], g->front[1], &changed_high);
+    ssd1306_gray_window_union(&changed, &changed_high);
+    ssd1306_gray_compare(p, g->back[0], g->back[1], &differ);
+
+    // the plane loop runs in the main loop too, nothing here races it
+    if(!ssd1306_gray_window_empty(&changed)) {
+        // the area stays changed until both planes went out after the last commit
+        if(!g->stale[0] && !g->stale[1])
+            ssd1306_gray_window_clear(&g->changed);
+        ssd1306_gray_window_union(&g->changed, &changed);
+        g->stale[0]=g->stale[1]=true;
+        memcpy(g->front[0], g->back[0], size);
+        memcpy(g->front[1], g->back[1], size);
+    }
+    g->differ=differ;
+
+#ifdef SSD1306_CAPTURE
+    if(p->capture && ssd1306_is_dirty(p))
+        ssd1306_capture_frame(p->capture, p);
+#endif
+    ssd1306_mark_clean(p);
+}
+
+// flush callback, in interrupt context
+static void ssd1306_gray_done(ssd1306_t *p, void *ctx) {
+    ssd1306_gray_t *g=ctx;
+    const uint32_t us=time_us_64()-g->send_us;
+
+    (void) p;
+    g->stats.last_us=us;
+    if(us>g->stats.max_us)
+        g->stats.max_us=us;
+}
+
+void ssd1306_gray_step(ssd1306_gray_t *g) {
+    ssd1306_t *p=g->disp;
+    ssd1306_gray_stats_t *s=&g->stats;
+
+    ++s->ticks;
+    if(ssd1306_show_busy(p)) {
+        ++s->missed; // the plane on the display stays one more tick
+        return;
+    }
+    ++s->planes;
+
+    const uint8_t plane=ssd1306_gray_cycle[g->slot];
+    g->slot=(g->slot+1)%SSD1306_GRAY_CYCLE;
+
+    ssd1306_gray_window_t w;
+    if(g->shown<0) {
+        // whatever the display showed before, the whole plane goes out
+        w.x0=0;
+        w.x1=p->width-1;
+        w.page0=0;
+        w.page1=p->pages-1;
+        g->stale[0]=g->stale[1]=false;
+        ssd1306_gray_window_clear(&g->changed);
+    } else {
+        ssd1306_gray_window_clear(&w);
+        if(plane!=g->shown)
+            ssd1306_gray_window_union(&w, &g->differ);
+        if(g->stale[plane] || g->stale[g->shown])
+            ssd1306_gray_window_union(&w, &g->changed);
+        g->stale[plane]=false;
+    }
+    g->shown=plane;
+
+    if(ssd1306_gray_window_empty(&w))
+        return;
+
+    uint8_t *dst=g->tx+1;
+    for(uint8_t page=w.page0; page<=w.page1; ++page) {
+        memcpy(dst, g->front[plane]+page*p->width+w.x0, w.x1-w.x0+1);
+        dst+=w.x1-w.x0+1;
+    }
+
+    ++s->sent;
+    s->bytes+=dst-(g->tx+1);
+    g->send_us=time_us_64();
+    ssd1306_show_window_async(p, g->tx+1, w.x0, w.x1, w.page0, w.page1, ssd1306_gray_done, g);
+}
+
+// in interrupt context: only flag the plane, the main loop sends it
+static bool ssd1306_gray_timer(repeating_timer_t *rt) {
+    ssd1306_gray_t *g=rt->user_data;
+
+    if(g->due)
+        ++g->overruns;
+    g->due=true;
+    if(g->wake)
+        g->wake(g->wake_ctx);
+    return true;
+}
+
+void ssd1306_gray_set_wake(ssd1306_gray_t *g, ssd1306_gray_wake_t wake, void *ctx) {
+    g->wake=wake;
+    g->wake_ctx=ctx;
+}
+
+bool ssd1306_gray_service(ssd1306_gray_t *g) {
+    if(!g->due)
+        return false;
+
+    const uint32_t status=save_and_disable_interrupts();
+    const uint32_t overruns=g->overruns;
+    g->due=false;
+    g->overruns=0;
+    restore_interrupts(status);
+
+    // a tick the loop did not get to leaves the plane on the display one more tick
+    g->stats.ticks+=overruns;
+    g->stats.missed+=overruns;
+    ssd1306_gray_step(g);
+    return true;
+}
+
+bool ssd1306_gray_start(ssd1306_gray_t *g, uint32_t plane_hz) {
+    if(g->running)
+        return true;
+
+    memset(&g->stats, 0, sizeof(g->stats));
+    g->stats.start_us=time_us_64();
+    g->shown=-1;
+    g->slot=0;
+    g->due=false;
+    g->overruns=0;
+
+    // a negative delay keeps the ticks a fixed period apart, however long a tick takes
+    const int64_t period_us=1000000/(plane_hz?plane_hz:1);
+    g->running=add_repeating_timer_us(-period_us, ssd1306_gray_timer, g, &g->timer);
+
+    return g->running;
+}
+
+void ssd1306_gray_stop(ssd1306_gray_t *g) {
+    if(!g->running)
+        return;
+
+    cancel_repeating_timer(&g->timer);
+    g->running=false;
+    g->due=false;
+    g->stats.stop_us=time_us_64();
+
+    ssd1306_show_wait(g->disp);
+    ssd1306_mark_dirty(g->disp, 0, 0, g->disp->width, g->disp->height);
+}
+
+uint32_t ssd1306_gray_plane_rate(const ssd1306_gray_t *g) {
+    const uint64_t elapsed=(g->stats.stop_us?g->stats.stop_us:time_us_64())-g->stats.start_us;
+
+    return elapsed?(uint32_t)((uint64_t) g->stats.planes*1000000/elapsed):0;
+}
+
+const ssd1306_gray_stats_t *ssd1306_gray_stats(const ssd1306_gray_t *g) {
+    return &g->stats;
+}
@@ -0,0 +1,230 @@
+/**
+* @file gray.h
+*
+* four gray levels on the 1-bit panel by temporal dithering. every pixel
+* has a level 0-3 kept as two bit-planes, the high plane weighing two and
+* the low plane one. they are shown in turn, high, high, low, so a pixel
+* is lit in level of every three planes.
+*
+* a hardware timer paces the planes but never touches the bus: its tick
+* only flags a plane as due and calls the wake callback, the main loop
+* sends it from ssd1306_gray_service. on i2c a send may wait for or
+* recover the bus, which has no place in interrupt context.
+*
+* each plane is sent by dma, as one window around the columns where the
+* two planes differ: areas drawn at level 0 or 3 cost nothing once sent.
+* while the plane loop runs it owns the display, the framebuffer reaches
+* it only through ssd1306_gray_from_mono.
+*/
+
+#ifndef _inc_ssd1306_gray
+#define _inc_ssd1306_gray
+#include <pico/stdlib.h>
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief brightest level
+*/
+#define SSD1306_GRAY_MAX 3
+
+/**
+*	@brief planes of one dither cycle
+*/
+#define SSD1306_GRAY_CYCLE 3
+
+/**
+*	@brief plane loop statistics
+*
+*	the sustained plane rate, see ssd1306_gray_plane_rate, only matches
+*	the timer while missed stays 0. 1000000/max_us is about the fastest
+*	timer the bus keeps up with.
+*/
+typedef struct {
+    uint32_t ticks;			/**< timer ticks */
+    uint32_t planes;		/**< planes shown on their tick, including those with nothing to send */
+    uint32_t missed;		/**< ticks that found the previous plane still on the bus, or came before the last one was serviced */
+    uint32_t sent;			/**< planes that had to be sent */
+    uint32_t bytes;			/**< data bytes sent */
+    uint32_t last_us;		/**< time on the bus of the last plane sent */
+    uint32_t max_us;		/**< longest time on the bus of a plane */
+    uint64_t start_us;		/**< time_us_64 when the loop started */
+    uint64_t stop_us;		/**< time_us_64 when the loop stopped, 0 while it runs */
+} ssd1306_gray_stats_t;
+
+/**
+*	@brief called by the timer, in interrupt context, when a plane is due
+*/
+typedef void (*ssd1306_gray_wake_t)(void *ctx);
+
+/**
+*	@brief column and page range, empty if x0>x1
+*/
+typedef struct {
+    uint8_t x0, x1;
+    uint8_t page0, page1;
+} ssd1306_gray_window_t;
+
+/**
+*	@brief grayscale layer of a display
+*/
+typedef struct {
+    ssd1306_t *disp;		/**< display the planes go to */
+    uint8_t back[2][SSD1306_MAX_PAGES*128];		/**< planes drawn on, low then high, page format */
+    uint8_t front[2][SSD1306_MAX_PAGES*128];	/**< planes of the loop, as of the last commit */
+    uint8_t tx[SSD1306_MAX_PAGES*128+1];		/**< window on the bus, tx[0] is scratch for the transport */
+    ssd1306_gray_window_t differ;	/**< where the front planes differ */
+    ssd1306_gray_window_t changed;	/**< changed by commits since both planes were last sent */
+    bool stale[2];			/**< plane not sent since changed grew */
+    int8_t shown;			/**< plane on the display, -1 if unknown */
+    uint8_t slot;			/**< position in the dither cycle */
+    volatile bool running;	/**< the timer is on */
+    volatile bool due;		/**< a tick waits for ssd1306_gray_service */
+    volatile uint32_t overruns;	/**< ticks that found due still set, moved to stats by the service */
+    ssd1306_gray_wake_t wake;	/**< called on every tick, NULL if none */
+    void *wake_ctx;			/**< argument of wake */
+    uint64_t send_us;		/**< time_us_64 when the plane on the bus was started */
+    repeating_timer_t timer;	/**< plane timer */
+    ssd1306_gray_stats_t stats;	/**< loop statistics */
+} ssd1306_gray_t;
+
+/**
+*	@brief set up a grayscale layer with every pixel at level 0
+*
+*	@param[out] g : grayscale layer
+*	@param[in] p : instance of display
+*/
+void ssd1306_gray_init(ssd1306_gray_t *g, ssd1306_t *p);
+
+/**
+*	@brief set the level of a pixel
+*
+*	@param[in] g : grayscale layer
+*	@param[in] x : x position
+*	@param[in] y : y position
+*	@param[in] level : 0 (dark) to SSD1306_GRAY_MAX
+*/
+void ssd1306_gray_pixel(ssd1306_gray_t *g, uint32_t x, uint32_t y, uint8_t level);
+
+/**
+*	@brief set the level of a rectangle
+*
+*	@param[in] g : grayscale layer
+*	@param[in] x : x position of the upper left corner
+*	@param[in] y : y position of the upper left corner
+*	@param[in] width : width of the rectangle
+*	@param[in] height : height of the rectangle
+*	@param[in] level : 0 (dark) to SSD1306_GRAY_MAX
+*/
+void ssd1306_gray_fill_rect(ssd1306_gray_t *g, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t level);
+
+/**
+*	@brief take a rectangle of the framebuffer of the display at one level
+*
+*	lit pixels get level, the others 0. lets everything drawn with the
+*	1-bit functions be shown in gray.
+*
+*	@param[in] g : grayscale layer
+*	@param[in] x : x position of the upper left corner
+*	@param[in] y : y position of the upper left corner
+*	@param[in] width : width of the rectangle
+*	@param[in] height : height of the rectangle
+*	@param[in] level : level of the lit pixels
+*/
+void ssd1306_gray_from_mono(ssd1306_gray_t *g, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t level);
+
+/**
+*	@brief hand what was drawn to the plane loop
+*
+*	the framebuffer of the display is marked clean: what it holds reaches
+*	the display through the planes, not through ssd1306_show. a capture
+*	tap on the display, see capture.h, gets the framebuffer here instead,
+*	so it records the 1-bit image the planes were taken from.
+*
+*	@param[in] g : grayscale layer
+*/
+void ssd1306_gray_commit(ssd1306_gray_t *g);
+
+/**
+*	@brief set the callback of the timer ticks
+*
+*	it runs in interrupt context and should only get the main loop to
+*	call ssd1306_gray_service soon, e.g. by scheduling a task.
+*
+*	@param[in] g : grayscale layer
+*	@param[in] wake : callback, NULL for none
+*	@param[in] ctx : argument of wake
+*/
+void ssd1306_gray_set_wake(ssd1306_gray_t *g, ssd1306_gray_wake_t wake, void *ctx);
+
+/**
+*	@brief start the plane loop on a repeating hardware timer
+*
+*	the first plane is sent whole, after that only where the planes
+*	differ or changed.
+*
+*	@param[in] g : grayscale layer
+*	@param[in] plane_hz : planes per second, the gray image refreshes at a third of it
+*
+*	@return false if no timer could be set up
+*/
+bool ssd1306_gray_start(ssd1306_gray_t *g, uint32_t plane_hz);
+
+/**
+*	@brief stop the plane loop
+*
+*	waits for the plane on the bus and marks the whole framebuffer dirty,
+*	so the next flush of the display puts the 1-bit image back.
+*
+*	@param[in] g : grayscale layer
+*/
+void ssd1306_gray_stop(ssd1306_gray_t *g);
+
+/**
+*	@brief show the plane due by the timer, from the main loop
+*
+*	ticks the loop did not get to in time count as missed.
+*
+*	@param[in] g : grayscale layer
+*
+*	@return false if no plane was due
+*/
+bool ssd1306_gray_service(ssd1306_gray_t *g);
+
+/**
+*	@brief show the next plane, called by ssd1306_gray_service
+*
+*	does nothing but count a miss while the previous plane is still on
+*	the bus. may be called directly, e.g. on a host without timers, but
+*	never in interrupt context.
+*
+*	@param[in] g : grayscale layer
+*/
+void ssd1306_gray_step(ssd1306_gray_t *g);
+
+/**
+*	@brief planes shown per second on their tick, from the start to the stop of the loop (or now)
+*
+*	@param[in] g : grayscale layer
+*
+*	@return sustained plane rate in Hz
+*/
+uint32_t ssd1306_gray_plane_rate(const ssd1306_gray_t *g);
+
+/**
+*	@brief get plane loop statistics
+*
+*	@param[in] g : grayscale layer
+*
+*	@return statistics, valid as long as g
+*/
+const ssd1306_gray_stats_t *ssd1306_gray_stats(const ssd1306_gray_t *g);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
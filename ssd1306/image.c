@@ -0,0 +1,132 @@
+/**
+* @file image.c
+*
+* rle images decompressed page by page into the framebuffer or straight
+* to the display, reads bounded by the encoded size
+*/
+
+#include <pico/stdlib.h>
+#include <string.h>
+
+#include "image.h"
+#ifdef SSD1306_CAPTURE
+#include "capture.h"
+#endif
+
+typedef struct {
+    const uint8_t *src;		// next control byte
+    const uint8_t *end;		// end of the compressed data
+    uint8_t value;			// byte of the current run
+    bool run;				// current block is a run, not literals
+    uint16_t left;			// bytes left in the current block
+} ssd1306_rle_t;
+
+inline static void ssd1306_rle_init(ssd1306_rle_t *r, const ssd1306_image_t *img) {
+    r->src=img->data;
+    r->end=img->data+img->size;
+    r->left=0;
+}
+
+// decompress the next n bytes into dst, or skip them if dst is NULL
+static void ssd1306_rle_read(ssd1306_rle_t *r, uint8_t *dst, size_t n) {
+    while(n) {
+        if(!r->left) {
+            if(r->src>=r->end) {
+                if(dst)
+                    memset(dst, 0, n); // truncated image
+                return;
+            }
+
+            const uint8_t c=*r->src++;
+            r->run=c&0x80;
+            r->left=r->run?(c&0x7f)+2:c+1;
+            if(r->run) {
+                if(r->src>=r->end) {
+                    r->left=0; // run without its value, truncated
+                    continue;
+                }
+                r->value=*r->src++;
+            } else if(r->left>r->end-r->src) {
+                r->left=r->end-r->src; // literals cut short, truncated
+            }
+        }
+
+        const size_t k=n<r->left?n:r->left;
+        if(dst) {
+            if(r->run)
+                memset(dst, r->value, k);
+            else
+                memcpy(dst, r->src, k);
+            dst+=k;
+        }
+        if(!r->run)
+            r->src+=k;
+        r->left-=k;
+        n-=k;
+    }
+}
+
+// columns and pages of img that fit on the display at x, page
+inline static void ssd1306_image_clip(const ssd1306_t *p, const ssd1306_image_t *img, uint32_t x, uint32_t page, uint32_t *w, uint32_t *pages) {
+    *w=x<p->width?p->width-x:0;
+    if(*w>img->width)
+        *w=img->width;
+
+    *pages=page<p->pages?p->pages-page:0;
+    if(*pages>img->height/8u)
+        *pages=img->height/8u;
+}
+
+void ssd1306_image_draw(ssd1306_t *p, const ssd1306_image_t *img, uint32_t x, uint32_t page) {
+    uint32_t w, pages;
+    ssd1306_image_clip(p, img, x, page, &w, &pages);
+    if(!w || !pages)
+        return;
+
+    ssd1306_rle_t r;
+    ssd1306_rle_init(&r, img);
+    for(uint32_t i=0; i<pages; ++i) {
+        ssd1306_rle_read(&r, p->buffer+(page+i)*p->width+x, w);
+        ssd1306_rle_read(&r, NULL, img->width-w);
+    }
+
+    ssd1306_mark_dirty(p, x, page*8, w, pages*8);
+}
+
+size_t ssd1306_image_send(ssd1306_t *p, const ssd1306_image_t *img, uint32_t x, uint32_t page) {
+    uint32_t w, pages;
+    ssd1306_image_clip(p, img, x, page, &w, &pages);
+    if(!w || !pages || p->scrolling)
+        return 0;
+
+    uint8_t cmds[SSD1306_WINDOW_CMDS];
+    ssd1306_window_commands(cmds, p->width, x, x+w-1, page, page+pages-1);
+    ssd1306_write_cmds(p, cmds, sizeof(cmds)); // waits for a running async flush
+
+#ifdef SSD1306_CAPTURE
+    // the framebuffer does not see the image, the tap gets it over the last captured frame
+    uint8_t *shot=p->capture?ssd1306_capture_frame_begin(p->capture, p):NULL;
+#endif
+
+    uint8_t row[128+1]; // widest panel, row[0] is scratch for the transport
+    ssd1306_rle_t r;
+    ssd1306_rle_init(&r, img);
+    for(uint32_t i=0; i<pages; ++i) {
+        ssd1306_rle_read(&r, row+1, w);
+        ssd1306_rle_read(&r, NULL, img->width-w);
+        ++p->stats.transactions;
+        ssd1306_transport_write_data(p->transport, row+1, w);
+#ifdef SSD1306_CAPTURE
+        if(shot)
+            memcpy(shot+(page+i)*p->width+x, row+1, w);
+#endif
+    }
+
+#ifdef SSD1306_CAPTURE
+    if(shot)
+        ssd1306_capture_frame_end(p->capture, p);
+#endif
+    ssd1306_count_flush(p, w*pages);
+
+    return w*pages;
+}
@@ -0,0 +1,70 @@
+/**
+* @file image.h
+*
+* images compiled at build time by tools/ssd1306_assets.py: framebuffer
+* bytes in page order (page after page, column after column, bit 0 on
+* top), run-length compressed. drawing one is a single decompression
+* pass, no glyph or pixel work.
+*
+* compressed format, repeated until size bytes are used:
+*   c&0x80 : the next byte repeated (c&0x7f)+2 times
+*   else   : the next c+1 bytes as they are
+* the decoder never reads past size bytes; a truncated image goes on as
+* zeros from where its data ends.
+*/
+
+#ifndef _inc_ssd1306_image
+#define _inc_ssd1306_image
+#include <pico/stdlib.h>
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief compressed page-format image, usually const in flash
+*/
+typedef struct {
+    uint8_t width;			/**< columns */
+    uint8_t height;			/**< rows, a multiple of 8 */
+    uint16_t size;			/**< bytes in data */
+    const uint8_t *data;	/**< compressed bytes */
+} ssd1306_image_t;
+
+/**
+*	@brief decompress an image into the framebuffer
+*
+*	the image replaces what is under it and the area is marked dirty.
+*	parts outside the display are cut.
+*
+*	@param[in] p : instance of display
+*	@param[in] img : image
+*	@param[in] x : left column
+*	@param[in] page : top page
+*/
+void ssd1306_image_draw(ssd1306_t *p, const ssd1306_image_t *img, uint32_t x, uint32_t page);
+
+/**
+*	@brief decompress an image straight to the display, one transfer per page
+*
+*	the framebuffer is left alone and does not know about the image: the
+*	next flush of that area overwrites it. for screens shown once, like a
+*	splash, before the framebuffer is drawn. nothing is sent while the
+*	display scrolls in hardware. counted as a flush in the statistics,
+*	and captured over the last captured frame by a capture tap.
+*
+*	@param[in] p : instance of display
+*	@param[in] img : image
+*	@param[in] x : left column
+*	@param[in] page : top page
+*
+*	@return bytes sent
+*/
+size_t ssd1306_image_send(ssd1306_t *p, const ssd1306_image_t *img, uint32_t x, uint32_t page);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -32,91 +32,139 @@ SOFTWARE.
 
 #include "ssd1306.h"
 #include "font.h"
+#ifdef SSD1306_CAPTURE
+#include "capture.h"
+#endif
+
+// geometry is a compile time constant when the driver is built for one panel
+#ifdef SSD1306_STATIC_GEOMETRY
+#define DISP_WIDTH(p) SSD1306_STATIC_WIDTH
+#define DISP_HEIGHT(p) SSD1306_STATIC_HEIGHT
+#define DISP_PAGES(p) SSD1306_STATIC_PAGES
+#define DISP_BUFSIZE(p) SSD1306_STATIC_BUFSIZE
+#else
+#define DISP_WIDTH(p) ((p)->width)
+#define DISP_HEIGHT(p) ((p)->height)
+#define DISP_PAGES(p) ((p)->pages)
+#define DISP_BUFSIZE(p) ((p)->bufsize)
+#endif
 
 inline static void swap(int32_t *a, int32_t *b) {
-    int32_t *t=a;
+    int32_t t=*a;
     *a=*b;
-    *b=*t;
+    *b=t;
 }
 
-inline static void fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, char *name) {
-    switch(i2c_write_blocking(i2c, addr, src, len, false)) {
-    case PICO_ERROR_GENERIC:
-        printf("[%s] addr not acknowledged!\n", name);
-        break;
-    case PICO_ERROR_TIMEOUT:
-        printf("[%s] timeout!\n", name);
-        break;
-    default:
-        //printf("[%s] wrote successfully %lu bytes!\n", name, len);
-        break;
-    }
+void ssd1306_write_cmds(ssd1306_t *p, const uint8_t *cmds, size_t len) {
+    ssd1306_show_wait(p); // a blocking write would cut off a running async flush
+
+    ++p->stats.transactions;
+    ssd1306_transport_write_cmds(p->transport, cmds, len);
 }
 
 inline static void ssd1306_write(ssd1306_t *p, uint8_t val) {
-    uint8_t d[2]= {0x00, val};
-    fancy_write(p->i2c_i, p->address, d, 2, "ssd1306_write");
+    ssd1306_write_cmds(p, &val, 1);
 }
 
-bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance) {
+inline static void ssd1306_mark_page(ssd1306_t *p, uint32_t page, uint32_t x0, uint32_t x1) {
+    if(x0<p->dirty_x0[page])
+        p->dirty_x0[page]=x0;
+    if(x1>p->dirty_x1[page])
+        p->dirty_x1[page]=x1;
+}
+
+void ssd1306_mark_clean(ssd1306_t *p) {
+    memset(p->dirty_x0, 0xff, sizeof(p->dirty_x0));
+    memset(p->dirty_x1, 0, sizeof(p->dirty_x1));
+}
+
+bool ssd1306_is_dirty(const ssd1306_t *p) {
+    for(uint8_t page=0; page<DISP_PAGES(p); ++page)
+        if(p->dirty_x0[page]<=p->dirty_x1[page])
+            return true;
+
+    return false;
+}
+
+static ssd1306_i2c_t legacy_i2c; // transport of ssd1306_init
+
+bool ssd1306_init_transport(ssd1306_t *p, uint16_t width, uint16_t height, ssd1306_transport_t *transport) {
+#ifdef SSD1306_STATIC_GEOMETRY
+    if(width!=SSD1306_STATIC_WIDTH || height!=SSD1306_STATIC_HEIGHT)
+        return false;
+#endif
+
     p->width=width;
     p->height=height;
     p->pages=height/8;
-    p->address=address;
 
-    p->i2c_i=i2c_instance;
+    p->transport=transport;
+    transport->owner=p;
 
+    p->front=NULL;
+    p->busy=false;
+    p->scrolling=false;
+    p->flush_cb=NULL;
+    p->window_count=0;
+    p->window_next=0;
+#ifdef SSD1306_CAPTURE
+    p->capture=NULL;
+#endif
 
     p->bufsize=(p->pages)*(p->width);
+#ifdef SSD1306_STATIC_GEOMETRY
+    p->buffer=p->storage;
+#else
     if((p->buffer=malloc(p->bufsize+1))==NULL) {
         p->bufsize=0;
         return false;
     }
+#endif
 
     ++(p->buffer);
 
+    memset(&p->stats, 0, sizeof(p->stats));
+    ssd1306_mark_clean(p);
+    ssd1306_reset(p);
+
+    return true;
+}
+
+bool ssd1306_reset(ssd1306_t *p) {
+    ssd1306_show_wait(p);
+
+    // let the transport try even if it gave up on the display
+    p->transport->stats.consecutive_failures=0;
+    p->scrolling=false;
+
     // from https://github.com/makerportal/rpi-pico-ssd1306
-    uint8_t cmds[]= {
-        SET_DISP,
-        // timing and driving scheme
-        SET_DISP_CLK_DIV,
-        0x80,
-        SET_MUX_RATIO,
-        height - 1,
-        SET_DISP_OFFSET,
-        0x00,
-        // resolution and layout
-        SET_DISP_START_LINE,
-        // charge pump
-        SET_CHARGE_PUMP,
-        p->external_vcc?0x10:0x14,
-        SET_SEG_REMAP | 0x01,           // column addr 127 mapped to SEG0
-        SET_COM_OUT_DIR | 0x08,         // scan from COM[N] to COM0
-        SET_COM_PIN_CFG,
-        width>2*height?0x02:0x12,
-        // display
-        SET_CONTRAST,
-        0xff,
-        SET_PRECHARGE,
-        p->external_vcc?0x22:0xF1,
-        SET_VCOM_DESEL,
-        0x30,                           // or 0x40?
-        SET_ENTIRE_ON,                  // output follows RAM contents
-        SET_NORM_INV,                   // not inverted
-        SET_DISP | 0x01,
-        // address setting
-        SET_MEM_ADDR,
-        0x00,  // horizontal
-    };
+    const uint8_t cmds[]= {SSD1306_INIT_SEQUENCE(DISP_WIDTH(p), DISP_HEIGHT(p), p->external_vcc)};
 
-    for(size_t i=0; i<sizeof(cmds); ++i)
-        ssd1306_write(p, cmds[i]);
+    const uint32_t start=time_us_32();
+    ssd1306_write_cmds(p, cmds, sizeof(cmds));
+    p->stats.init_us=time_us_32()-start;
 
-    return true;
+    // whatever the display showed is lost
+    ssd1306_mark_dirty(p, 0, 0, DISP_WIDTH(p), DISP_HEIGHT(p));
+
+    return p->transport->stats.consecutive_failures==0;
+}
+
+bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance) {
+    return ssd1306_init_transport(p, width, height, ssd1306_i2c_init(&legacy_i2c, i2c_instance, address));
 }
 
 inline void ssd1306_deinit(ssd1306_t *p) {
+    ssd1306_show_wait(p);
+    if(p->transport->ops->release)
+        p->transport->ops->release(p->transport);
+    ssd1306_transport_dma_release(p->transport);
+    p->transport->owner=NULL;
+#ifndef SSD1306_STATIC_GEOMETRY
+    free(p->front);
     free(p->buffer-1);
+#endif
+    p->front=NULL;
 }
 
 inline void ssd1306_poweroff(ssd1306_t *p) {
@@ -128,69 +176,381 @@ inline void ssd1306_poweron(ssd1306_t *p) {
 }
 
 inline void ssd1306_contrast(ssd1306_t *p, uint8_t val) {
-    ssd1306_write(p, SET_CONTRAST);
-    ssd1306_write(p, val);
+    const uint8_t cmds[]= {SET_CONTRAST, val};
+    ssd1306_write_cmds(p, cmds, sizeof(cmds));
 }
 
 inline void ssd1306_invert(ssd1306_t *p, uint8_t inv) {
     ssd1306_write(p, SET_NORM_INV | (inv & 1));
 }
 
+void ssd1306_scroll_horizontal(ssd1306_t *p, bool left, uint8_t start_page, uint8_t end_page, ssd1306_scroll_speed_t speed) {
+    ssd1306_show(p);
+
+    const uint8_t cmds[]= {
+        SET_SCROLL_OFF,         // parameters may only change while stopped
+        left?SET_HSCROLL_LEFT:SET_HSCROLL_RIGHT,
+        0x00,
+        start_page&7,
+        speed&7,
+        end_page&7,
+        0x00,
+        0xFF,
+        SET_SCROLL_ON
+    };
+    ssd1306_write_cmds(p, cmds, sizeof(cmds));
+    p->scrolling=true;
+}
+
+void ssd1306_scroll_diagonal(ssd1306_t *p, bool left, uint8_t start_page, uint8_t end_page, ssd1306_scroll_speed_t speed, uint8_t vertical_offset) {
+    ssd1306_show(p);
+
+    const uint8_t cmds[]= {
+        SET_SCROLL_OFF,
+        SET_VSCROLL_AREA,       // whole display scrolls vertically
+        0x00,
+        DISP_HEIGHT(p),
+        left?SET_VHSCROLL_LEFT:SET_VHSCROLL_RIGHT,
+        0x00,
+        start_page&7,
+        speed&7,
+        end_page&7,
+        vertical_offset&0x3F,
+        SET_SCROLL_ON
+    };
+    ssd1306_write_cmds(p, cmds, sizeof(cmds));
+    p->scrolling=true;
+}
+
+void ssd1306_scroll_stop(ssd1306_t *p) {
+    ssd1306_write(p, SET_SCROLL_OFF);
+    p->scrolling=false;
+    ssd1306_mark_dirty(p, 0, 0, DISP_WIDTH(p), DISP_HEIGHT(p));
+}
+
+inline void ssd1306_set_start_line(ssd1306_t *p, uint8_t line) {
+    ssd1306_write(p, SET_DISP_START_LINE|(line&0x3F));
+}
+
 inline void ssd1306_clear(ssd1306_t *p) {
-    memset(p->buffer, 0, p->bufsize);
+    memset(p->buffer, 0, DISP_BUFSIZE(p));
+    ssd1306_mark_dirty(p, 0, 0, DISP_WIDTH(p), DISP_HEIGHT(p));
+}
+
+void ssd1306_mark_dirty(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    if(x>=DISP_WIDTH(p) || y>=DISP_HEIGHT(p) || !width || !height) return;
+
+    if(width>DISP_WIDTH(p)-x)
+        width=DISP_WIDTH(p)-x;
+    if(height>DISP_HEIGHT(p)-y)
+        height=DISP_HEIGHT(p)-y;
+
+    for(uint32_t page=y>>3; page<=(y+height-1)>>3; ++page)
+        ssd1306_mark_page(p, page, x, x+width-1);
+}
+
+const ssd1306_stats_t *ssd1306_get_stats(const ssd1306_t *p) {
+    return &p->stats;
+}
+
+const ssd1306_bus_stats_t *ssd1306_bus_stats(const ssd1306_t *p) {
+    return &p->transport->stats;
 }
 
 void ssd1306_clear_pixel(ssd1306_t *p, uint32_t x, uint32_t y) {
-    if(x>=p->width || y>=p->height) return;
+    if(x>=DISP_WIDTH(p) || y>=DISP_HEIGHT(p)) return;
 
-    p->buffer[x+p->width*(y>>3)]&=~(0x1<<(y&0x07));
+    uint8_t *b=&p->buffer[x+DISP_WIDTH(p)*(y>>3)];
+    const uint8_t v=*b&~(0x1<<(y&0x07));
+    if(v==*b) return; // unchanged, keep the page clean
+
+    *b=v;
+    ssd1306_mark_page(p, y>>3, x, x);
 }
 
 void ssd1306_draw_pixel(ssd1306_t *p, uint32_t x, uint32_t y) {
-    if(x>=p->width || y>=p->height) return;
+    if(x>=DISP_WIDTH(p) || y>=DISP_HEIGHT(p)) return;
+
+    uint8_t *b=&p->buffer[x+DISP_WIDTH(p)*(y>>3)];
+    const uint8_t v=*b|(0x1<<(y&0x07)); // y>>3==y/8 && y&0x7==y%8
+    if(v==*b) return; // unchanged, keep the page clean
 
-    p->buffer[x+p->width*(y>>3)]|=0x1<<(y&0x07); // y>>3==y/8 && y&0x7==y%8
+    *b=v;
+    ssd1306_mark_page(p, y>>3, x, x);
 }
 
-void ssd1306_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
-    if(x1>x2) {
-        swap(&x1, &x2);
-        swap(&y1, &y2);
-    }
+typedef enum {
+    RECT_FILL,
+    RECT_CLEAR,
+    RECT_INVERT
+} rect_op_t;
 
-    if(x1==x2) {
-        if(y1>y2)
-            swap(&y1, &y2);
-        for(int32_t i=y1; i<=y2; ++i)
-            ssd1306_draw_pixel(p, x1, i);
-        return;
+typedef uint32_t __attribute__((__may_alias__)) word_t; // buffer is accessed bytewise too
+
+inline static uint8_t rect_apply(uint8_t b, uint8_t mask, rect_op_t op) {
+    switch(op) {
+    case RECT_FILL:
+        return b|mask;
+    case RECT_CLEAR:
+        return b&~mask;
+    default:
+        return b^mask;
     }
+}
+
+/**
+*	applies op to whole page bytes: the first and last page get a mask for
+*	the rows they cover, pages in between are written 4 bytes at a time.
+*	only the columns that really changed are marked dirty.
+*/
+static void ssd1306_rect_op(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height, rect_op_t op) {
+    if(x>=DISP_WIDTH(p) || y>=DISP_HEIGHT(p) || !width || !height) return;
 
-    float m=(float) (y2-y1) / (float) (x2-x1);
+    if(width>DISP_WIDTH(p)-x)
+        width=DISP_WIDTH(p)-x;
+    if(height>DISP_HEIGHT(p)-y)
+        height=DISP_HEIGHT(p)-y;
 
-    for(int32_t i=x1; i<=x2; ++i) {
-        float y=m*(float) (i-x1)+(float) y1;
-        ssd1306_draw_pixel(p, i, (uint32_t) y);
+    const uint32_t x_end=x+width-1;
+    const uint32_t y_end=y+height-1;
+
+    for(uint32_t page=y>>3; page<=y_end>>3; ++page) {
+        uint8_t mask=0xff;
+        if(page==y>>3)
+            mask&=0xff<<(y&7);
+        if(page==y_end>>3)
+            mask&=0xff>>(7-(y_end&7));
+
+        uint8_t *row=p->buffer+page*DISP_WIDTH(p);
+        uint32_t first=UINT32_MAX, last=0;
+        uint32_t i=x;
+
+        if(mask==0xff) {
+            for(; i<=x_end && ((uintptr_t) (row+i)&3); ++i) {
+                const uint8_t v=rect_apply(row[i], 0xff, op);
+                if(v!=row[i]) {
+                    row[i]=v;
+                    if(first==UINT32_MAX) first=i;
+                    last=i;
+                }
+            }
+
+            const word_t fill=op==RECT_FILL?0xffffffff:0;
+            for(; i+3<=x_end; i+=4) {
+                word_t *w=(word_t *) (row+i);
+                const word_t v=op==RECT_INVERT?~*w:fill;
+                if(v!=*w) {
+                    *w=v;
+                    if(first==UINT32_MAX) first=i;
+                    last=i+3;
+                }
+            }
+        }
+
+        for(; i<=x_end; ++i) {
+            const uint8_t v=rect_apply(row[i], mask, op);
+            if(v!=row[i]) {
+                row[i]=v;
+                if(first==UINT32_MAX) first=i;
+                last=i;
+            }
+        }
+
+        if(first!=UINT32_MAX)
+            ssd1306_mark_page(p, page, first, last);
     }
 }
 
+void ssd1306_fill_rect(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    ssd1306_rect_op(p, x, y, width, height, RECT_FILL);
+}
+
+void ssd1306_clear_rect(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    ssd1306_rect_op(p, x, y, width, height, RECT_CLEAR);
+}
+
+void ssd1306_invert_rect(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    ssd1306_rect_op(p, x, y, width, height, RECT_INVERT);
+}
+
 void ssd1306_clear_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
-    for(uint32_t i=0; i<width; ++i)
-        for(uint32_t j=0; j<height; ++j)
-            ssd1306_clear_pixel(p, x+i, y+j);
+    ssd1306_rect_op(p, x, y, width, height, RECT_CLEAR);
 }
 
 void ssd1306_draw_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
-    for(uint32_t i=0; i<width; ++i)
-        for(uint32_t j=0; j<height; ++j)
-            ssd1306_draw_pixel(p, x+i, y+j);
+    ssd1306_rect_op(p, x, y, width, height, RECT_FILL);
+}
+
+enum {
+    CLIP_LEFT=1,
+    CLIP_RIGHT=2,
+    CLIP_TOP=4,
+    CLIP_BOTTOM=8
+};
+
+inline static uint8_t clip_code(int32_t width, int32_t height, int32_t x, int32_t y) {
+    uint8_t c=0;
+
+    if(x<0) c|=CLIP_LEFT;
+    else if(x>=width) c|=CLIP_RIGHT;
+    if(y<0) c|=CLIP_TOP;
+    else if(y>=height) c|=CLIP_BOTTOM;
+
+    return c;
+}
+
+inline static int32_t div_round(int64_t num, int64_t den) {
+    if(den<0) {
+        num=-num;
+        den=-den;
+    }
+    return (int32_t) (num>=0?(num+den/2)/den:-((-num+den/2)/den));
+}
+
+// cohen-sutherland in integer math
+bool ssd1306_clip_line(uint32_t width, uint32_t height, int32_t *x1, int32_t *y1, int32_t *x2, int32_t *y2) {
+    const int32_t x_max=width-1;
+    const int32_t y_max=height-1;
+    uint8_t c1=clip_code(width, height, *x1, *y1);
+    uint8_t c2=clip_code(width, height, *x2, *y2);
+
+    while(c1|c2) {
+        if(c1&c2)
+            return false;
+
+        const uint8_t c=c1?c1:c2;
+        const int64_t dx=(int64_t) *x2-*x1;
+        const int64_t dy=(int64_t) *y2-*y1;
+        int32_t x, y;
+
+        if(c&CLIP_TOP) {
+            y=0;
+            x=*x1+div_round(dx*(0-(int64_t) *y1), dy);
+        } else if(c&CLIP_BOTTOM) {
+            y=y_max;
+            x=*x1+div_round(dx*(y_max-(int64_t) *y1), dy);
+        } else if(c&CLIP_LEFT) {
+            x=0;
+            y=*y1+div_round(dy*(0-(int64_t) *x1), dx);
+        } else {
+            x=x_max;
+            y=*y1+div_round(dy*(x_max-(int64_t) *x1), dx);
+        }
+
+        if(c==c1) {
+            *x1=x;
+            *y1=y;
+            c1=clip_code(width, height, x, y);
+        } else {
+            *x2=x;
+            *y2=y;
+            c2=clip_code(width, height, x, y);
+        }
+    }
+
+    return true;
+}
+
+/**
+*	bresenham, clipped once up front. pixels are collected into runs along
+*	the major axis, each run is written as a byte span by ssd1306_fill_rect.
+*/
+void ssd1306_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    if(!ssd1306_clip_line(DISP_WIDTH(p), DISP_HEIGHT(p), &x1, &y1, &x2, &y2))
+        return;
+
+    const int32_t dx=x2>x1?x2-x1:x1-x2;
+    const int32_t dy=y2>y1?y2-y1:y1-y2;
+
+    if(dx>=dy) { // shallow, horizontal runs
+        if(x1>x2) {
+            swap(&x1, &x2);
+            swap(&y1, &y2);
+        }
+
+        const int32_t sy=y1<y2?1:-1;
+        int32_t err=dx/2;
+        int32_t start=x1;
+
+        for(int32_t x=x1, y=y1; x<=x2; ++x) {
+            err-=dy;
+            if(err<0 || x==x2) {
+                ssd1306_fill_rect(p, start, y, x-start+1, 1);
+                start=x+1;
+                if(err<0) {
+                    y+=sy;
+                    err+=dx;
+                }
+            }
+        }
+    } else { // steep, vertical runs
+        if(y1>y2) {
+            swap(&x1, &x2);
+            swap(&y1, &y2);
+        }
+
+        const int32_t sx=x1<x2?1:-1;
+        int32_t err=dy/2;
+        int32_t start=y1;
+
+        for(int32_t y=y1, x=x1; y<=y2; ++y) {
+            err-=dx;
+            if(err<0 || y==y2) {
+                ssd1306_fill_rect(p, x, start, 1, y-start+1);
+                start=y+1;
+                if(err<0) {
+                    x+=sx;
+                    err+=dy;
+                }
+            }
+        }
+    }
 }
 
 void ssd1306_draw_empty_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
-    ssd1306_draw_line(p, x, y, x+width, y);
-    ssd1306_draw_line(p, x, y+height, x+width, y+height);
-    ssd1306_draw_line(p, x, y, x, y+height);
-    ssd1306_draw_line(p, x+width, y, x+width, y+height);
+    ssd1306_fill_rect(p, x, y, width+1, 1);
+    ssd1306_fill_rect(p, x, y+height, width+1, 1);
+    ssd1306_fill_rect(p, x, y, 1, height+1);
+    ssd1306_fill_rect(p, x+width, y, 1, height+1);
+}
+
+#define EXPAND_BIT(n, b, s) ((((n)>>(b))&1)?((1u<<(s))-1)<<((b)*(s)):0)
+#define EXPAND_NIBBLE(n, s) (EXPAND_BIT(n, 0, s)|EXPAND_BIT(n, 1, s)|EXPAND_BIT(n, 2, s)|EXPAND_BIT(n, 3, s))
+#define EXPAND_ROW(s) { \
+    EXPAND_NIBBLE(0, s), EXPAND_NIBBLE(1, s), EXPAND_NIBBLE(2, s), EXPAND_NIBBLE(3, s), \
+    EXPAND_NIBBLE(4, s), EXPAND_NIBBLE(5, s), EXPAND_NIBBLE(6, s), EXPAND_NIBBLE(7, s), \
+    EXPAND_NIBBLE(8, s), EXPAND_NIBBLE(9, s), EXPAND_NIBBLE(10, s), EXPAND_NIBBLE(11, s), \
+    EXPAND_NIBBLE(12, s), EXPAND_NIBBLE(13, s), EXPAND_NIBBLE(14, s), EXPAND_NIBBLE(15, s) }
+
+// every bit of a nibble repeated 2, 3 or 4 times
+static const uint16_t expand_nibble[3][16]= {EXPAND_ROW(2), EXPAND_ROW(3), EXPAND_ROW(4)};
+
+/**
+*	font column (up to 8 rows) scaled vertically by scale (1-4)
+*/
+inline static uint32_t ssd1306_expand_column(uint8_t line, uint32_t scale) {
+    if(scale==1)
+        return line;
+
+    const uint16_t *t=expand_nibble[scale-2];
+    return t[line&0x0f]|((uint32_t) t[line>>4]<<(4*scale));
+}
+
+/**
+*	ors a column of up to 32 pixels starting at y into the buffer,
+*	split over the pages it touches.
+*/
+inline static void ssd1306_or_column(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t bits) {
+    uint64_t v=(uint64_t) bits<<(y&7);
+    uint8_t *b=p->buffer+x+DISP_WIDTH(p)*(y>>3);
+
+    for(uint32_t page=y>>3; v && page<DISP_PAGES(p); ++page, v>>=8, b+=DISP_WIDTH(p)) {
+        const uint8_t n=*b|(uint8_t) v;
+        if(n!=*b) {
+            *b=n;
+            ssd1306_mark_page(p, page, x, x);
+        }
+    }
 }
 
 void ssd1306_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, char c) {
@@ -198,6 +558,27 @@ void ssd1306_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t
         return;
 
     uint32_t parts_per_line=(font[0]>>3)+((font[0]&7)>0);
+
+    if(parts_per_line==1 && scale>=1 && scale<=4) {
+        // one byte per column: expand it and write whole page bytes
+        if(y>=DISP_HEIGHT(p))
+            return;
+
+        const uint8_t *col=font+5+(c-font[3])*font[1];
+        for(uint8_t w=0; w<font[1]; ++w) {
+            const uint32_t bits=ssd1306_expand_column(col[w], scale);
+            if(!bits)
+                continue;
+
+            for(uint32_t i=0; i<scale; ++i) {
+                const uint32_t xc=x+w*scale+i;
+                if(xc<DISP_WIDTH(p))
+                    ssd1306_or_column(p, xc, y, bits);
+            }
+        }
+        return;
+    }
+
     for(uint8_t w=0; w<font[1]; ++w) { // width
         uint32_t pp=(c-font[3])*font[1]*parts_per_line+w*parts_per_line+5;
         for(uint32_t lp=0; lp<parts_per_line; ++lp) {
@@ -213,6 +594,63 @@ void ssd1306_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t
     }
 }
 
+bool ssd1306_atlas_init(ssd1306_atlas_t *a, const uint8_t *font, uint32_t scale, uint32_t y_shift, char first, char last, uint8_t *storage, size_t storage_size) {
+    if(font[0]>8 || scale<1 || scale>4 || y_shift>7 || first<font[3] || last>font[4] || first>last)
+        return false;
+
+    const uint32_t count=last-first+1;
+    if(storage_size<SSD1306_ATLAS_BYTES(count, font[1], scale))
+        return false;
+
+    a->first=first;
+    a->count=count;
+    a->width=font[1]*scale;
+    a->pages=(y_shift+font[0]*scale+7)>>3;
+    a->data=storage;
+
+    const uint64_t cover=(uint64_t) ssd1306_expand_column(0xff>>(8-font[0]), scale)<<y_shift;
+    for(uint32_t i=0; i<a->pages; ++i)
+        a->mask[i]=(uint8_t) (cover>>(8*i));
+
+    for(uint32_t g=0; g<count; ++g) {
+        const uint8_t *col=font+5+(first-font[3]+g)*font[1];
+        uint8_t *dst=a->data+g*a->pages*a->width;
+
+        for(uint32_t x=0; x<a->width; ++x) {
+            const uint64_t bits=(uint64_t) ssd1306_expand_column(col[x/scale], scale)<<y_shift;
+            for(uint32_t i=0; i<a->pages; ++i)
+                dst[i*a->width+x]=(uint8_t) (bits>>(8*i));
+        }
+    }
+
+    return true;
+}
+
+void ssd1306_atlas_draw_char(ssd1306_t *p, const ssd1306_atlas_t *a, uint32_t x, uint32_t page, char c) {
+    if((uint8_t) c<a->first || (uint8_t) c>=a->first+a->count)
+        return;
+
+    const uint8_t *src=a->data+((uint8_t) c-a->first)*a->pages*a->width;
+
+    for(uint32_t i=0; i<a->pages && page+i<DISP_PAGES(p); ++i, src+=a->width) {
+        uint8_t *dst=p->buffer+(page+i)*DISP_WIDTH(p);
+        const uint8_t keep=~a->mask[i];
+        uint32_t first=UINT32_MAX, last=0;
+
+        for(uint32_t w=0; w<a->width && x+w<DISP_WIDTH(p); ++w) {
+            const uint8_t v=(dst[x+w]&keep)|src[w];
+            if(v!=dst[x+w]) {
+                dst[x+w]=v;
+                if(first==UINT32_MAX) first=x+w;
+                last=x+w;
+            }
+        }
+
+        if(first!=UINT32_MAX)
+            ssd1306_mark_page(p, page+i, first, last);
+    }
+}
+
 void ssd1306_draw_string_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, const char *s) {
     for(int32_t x_n=x; *s; x_n+=(font[1]+font[2])*scale) {
         ssd1306_draw_char_with_font(p, x_n, y, scale, font, *(s++));
@@ -241,6 +679,78 @@ static inline uint32_t ssd1306_bmp_get_val(const uint8_t *data, const size_t off
     __builtin_unreachable();
 }
 
+/**
+*	transposes an 8x8 bit matrix: bit b of byte i ends up as bit i of byte b.
+*	three delta swaps, no branches (hacker's delight 7-3).
+*/
+inline static uint64_t transpose8(uint64_t x) {
+    uint64_t t;
+
+    t=(x^(x>>7))&0x00aa00aa00aa00aaULL;
+    x=x^t^(t<<7);
+    t=(x^(x>>14))&0x0000cccc0000ccccULL;
+    x=x^t^(t<<14);
+    t=(x^(x>>28))&0x00000000f0f0f0f0ULL;
+    x=x^t^(t<<28);
+
+    return x;
+}
+
+/**
+*	reads 8 image rows at a time and turns every 8x8 block into 8 column
+*	bytes of one page. y_offset must be page aligned.
+*/
+static void ssd1306_bmp_blit_pages(ssd1306_t *p, const uint8_t *img_data, uint32_t bytes_per_line, uint32_t width, int32_t height, uint8_t color_val, uint32_t x_offset, uint32_t y_offset) {
+    const uint32_t rows=height>0?(uint32_t) height:(uint32_t) -height;
+    const uint8_t invert=color_val?0x00:0xff; // pixels equal to color_val are drawn
+
+    for(uint32_t r0=0; r0<rows; r0+=8) {
+        const uint32_t page=(y_offset+r0)>>3;
+        if(page>=DISP_PAGES(p))
+            break;
+
+        const uint8_t *line[8];
+        for(uint32_t i=0; i<8; ++i) {
+            const uint32_t r=r0+i;
+            line[i]=r>=rows?NULL:img_data+(height>0?rows-1-r:r)*bytes_per_line; // bottom-up if height>0
+        }
+
+        uint8_t *dst=p->buffer+page*DISP_WIDTH(p);
+        uint32_t first=UINT32_MAX, last=0;
+
+        for(uint32_t bx=0; bx*8<width && x_offset+bx*8<DISP_WIDTH(p); ++bx) {
+            const uint8_t edge=width-bx*8<8?(uint8_t) (0xff<<(8-(width-bx*8))):0xff;
+            uint64_t block=0;
+
+            for(uint32_t i=0; i<8; ++i) {
+                if(line[i])
+                    block|=(uint64_t) ((line[i][bx]^invert)&edge)<<(8*i);
+            }
+
+            if(!block)
+                continue;
+
+            block=transpose8(block); // byte b: column 7-b of the block
+
+            for(uint32_t j=0; j<8; ++j) {
+                const uint32_t x=x_offset+bx*8+j;
+                const uint8_t col=(uint8_t) (block>>(8*(7-j)));
+
+                if(x>=DISP_WIDTH(p))
+                    break;
+                if((dst[x]|col)!=dst[x]) {
+                    dst[x]|=col;
+                    if(first==UINT32_MAX) first=x;
+                    last=x;
+                }
+            }
+        }
+
+        if(first!=UINT32_MAX)
+            ssd1306_mark_page(p, page, first, last);
+    }
+}
+
 void ssd1306_bmp_show_image_with_offset(ssd1306_t *p, const uint8_t *data, const long size, uint32_t x_offset, uint32_t y_offset) {
     if(size<54) // data smaller than header
         return;
@@ -273,7 +783,17 @@ void ssd1306_bmp_show_image_with_offset(ssd1306_t *p, const uint8_t *data, const
         bytes_per_line=(bytes_per_line^(bytes_per_line&3))+4;
 
     const uint8_t *img_data=data+bfOffBits;
+    const uint32_t rows=biHeight>0?(uint32_t) biHeight:(uint32_t) -biHeight;
+
+    if((uint64_t) bfOffBits+(uint64_t) bytes_per_line*rows>(uint64_t) size) // truncated image
+        return;
 
+    if(!(y_offset&7)) {
+        ssd1306_bmp_blit_pages(p, img_data, bytes_per_line, biWidth, biHeight, color_val, x_offset, y_offset);
+        return;
+    }
+
+    // unaligned offset, pixel by pixel
     int32_t step=biHeight>0?-1:1;
     int32_t border=biHeight>0?-1:-biHeight;
 
@@ -290,17 +810,314 @@ inline void ssd1306_bmp_show_image(ssd1306_t *p, const uint8_t *data, const long
     ssd1306_bmp_show_image_with_offset(p, data, size, 0, 0);
 }
 
+#define SSD1306_WINDOW_COST (SSD1306_WINDOW_CMDS+4) // bytes on i2c: commands, two addresses, two control bytes
+
+void ssd1306_window_commands(uint8_t *cmds, uint32_t width, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+    const uint8_t col_offset=width==64?32:0; // 64 wide panels sit in the middle of the controller ram
+
+    cmds[0]=SET_COL_ADDR;
+    cmds[1]=x0+col_offset;
+    cmds[2]=x1+col_offset;
+    cmds[3]=SET_PAGE_ADDR;
+    cmds[4]=page0;
+    cmds[5]=page1;
+}
+
+inline static void ssd1306_window_cmds(const ssd1306_t *p, uint8_t *cmds, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+    (void) p; // geometry may be compile time constants
+    ssd1306_window_commands(cmds, DISP_WIDTH(p), x0, x1, page0, page1);
+}
+
+inline static void ssd1306_set_window(ssd1306_t *p, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+    uint8_t payload[SSD1306_WINDOW_CMDS];
+
+    ssd1306_window_cmds(p, payload, x0, x1, page0, page1);
+    ssd1306_write_cmds(p, payload, sizeof(payload));
+}
+
+void ssd1306_count_flush(ssd1306_t *p, size_t sent) {
+    ++p->stats.flushes;
+    if(!sent)
+        ++p->stats.skipped;
+
+    p->stats.bytes_sent+=sent;
+    p->stats.bytes_saved+=DISP_BUFSIZE(p)-sent;
+    p->stats.last_bytes_sent=sent;
+    p->stats.last_bytes_saved=DISP_BUFSIZE(p)-sent;
+}
+
+/**
+*	sends columns x0..x1 of pages page0..page1 as one window, straight from
+*	the buffer (the transport may borrow the byte before the window). a
+*	multi page window must span the full width, otherwise its data is not
+*	contiguous in the buffer.
+*/
+static void ssd1306_send_window(ssd1306_t *p, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+    ssd1306_set_window(p, x0, x1, page0, page1);
+
+    uint8_t *start=p->buffer+page0*DISP_WIDTH(p)+x0;
+    const size_t len=(page1-page0)*DISP_WIDTH(p)+(x1-x0)+1;
+
+    ++p->stats.transactions;
+    ssd1306_transport_write_data(p->transport, start, len);
+}
+
 void ssd1306_show(ssd1306_t *p) {
-    uint8_t payload[]= {SET_COL_ADDR, 0, p->width-1, SET_PAGE_ADDR, 0, p->pages-1};
-    if(p->width==64) {
-        payload[1]+=32;
-        payload[2]+=32;
+    size_t sent=0;
+
+    if(p->scrolling)
+        return;     // the controller owns the ram until ssd1306_scroll_stop
+
+#ifdef SSD1306_CAPTURE
+    // a flush with nothing dirty leaves the screen as it was
+    if(p->capture && ssd1306_is_dirty(p))
+        ssd1306_capture_frame(p->capture, p);
+#endif
+
+    for(uint8_t page=0; page<DISP_PAGES(p); ++page) {
+        const uint8_t x0=p->dirty_x0[page];
+        const uint8_t x1=p->dirty_x1[page];
+
+        if(x0>x1)
+            continue;
+
+        uint8_t last=page;
+        if(x0==0 && x1==DISP_WIDTH(p)-1) {
+            // merge following full width pages into a single window
+            while(last+1<DISP_PAGES(p) && p->dirty_x0[last+1]==0 && p->dirty_x1[last+1]==DISP_WIDTH(p)-1)
+                ++last;
+        }
+
+        ssd1306_send_window(p, x0, x1, page, last);
+        sent+=(last-page)*DISP_WIDTH(p)+(x1-x0)+1;
+        page=last;
+    }
+
+    ssd1306_mark_clean(p);
+    ssd1306_count_flush(p, sent);
+}
+
+void ssd1306_show_span(ssd1306_t *p, uint32_t page, uint32_t x, uint32_t width) {
+    if(page>=DISP_PAGES(p) || x>=DISP_WIDTH(p) || !width) return;
+
+    if(width>DISP_WIDTH(p)-x)
+        width=DISP_WIDTH(p)-x;
+
+    if(p->scrolling) {
+        ssd1306_mark_page(p, page, x, x+width-1); // sent after ssd1306_scroll_stop
+        return;
+    }
+
+#ifdef SSD1306_CAPTURE
+    if(p->capture)
+        ssd1306_capture_frame(p->capture, p);
+#endif
+
+    ssd1306_send_window(p, x, x+width-1, page, page);
+    ssd1306_count_flush(p, width);
+}
+
+inline static size_t ssd1306_window_len(const ssd1306_window_t *w) {
+    return (w->x1-w->x0+1)*(w->page1-w->page0+1);
+}
+
+/**
+*	hands the next window of an async flush to the transport. false if the
+*	transport cannot send it in the background, the window is then still
+*	the next one.
+*/
+static bool ssd1306_window_async(ssd1306_t *p) {
+    const ssd1306_window_t *w=&p->windows[p->window_next];
+    uint8_t *data=p->window_data;
+    uint8_t cmds[SSD1306_WINDOW_CMDS];
+
+    if(!p->transport->ops->write_data_async)
+        return false;
+
+    // advanced first, a transport may report completion before returning
+    ssd1306_window_cmds(p, cmds, w->x0, w->x1, w->page0, w->page1);
+    ++p->window_next;
+    p->window_data+=ssd1306_window_len(w);
+    ++p->stats.transactions;
+    if(p->transport->ops->write_data_async(p->transport, cmds, sizeof(cmds), data, ssd1306_window_len(w)))
+        return true;
+
+    --p->window_next;
+    p->window_data=data;
+    --p->stats.transactions;
+    return false;
+}
+
+/**
+*	starts the windows queued in p->windows, sending them blocking if the
+*	transport cannot do it in the background. false in that case.
+*/
+static bool ssd1306_windows_start(ssd1306_t *p, uint8_t *data, ssd1306_flush_cb_t cb, void *ctx) {
+    p->window_next=0;
+    p->window_data=data;
+    p->flush_cb=cb;
+    p->flush_ctx=ctx;
+    p->busy=true;
+    if(ssd1306_window_async(p))
+        return true;
+
+    // no dma available, send them blocking
+    for(; p->window_next<p->window_count; ++p->window_next) {
+        const ssd1306_window_t *w=&p->windows[p->window_next];
+        uint8_t cmds[SSD1306_WINDOW_CMDS];
+
+        ssd1306_window_cmds(p, cmds, w->x0, w->x1, w->page0, w->page1);
+        p->stats.transactions+=2;
+        ssd1306_transport_write_cmds(p->transport, cmds, sizeof(cmds));
+        ssd1306_transport_write_data(p->transport, p->window_data, ssd1306_window_len(w));
+        p->window_data+=ssd1306_window_len(w);
     }
+    ssd1306_transport_done(p->transport);
+    return false;
+}
+
+void ssd1306_transport_done(ssd1306_transport_t *t) {
+    ssd1306_t *p=t->owner;
 
-    for(size_t i=0; i<sizeof(payload); ++i)
-        ssd1306_write(p, payload[i]);
+    if(!p)
+        return;
+
+    // next window of the flush; if the transport refuses it (display offline) the rest is dropped
+    if(p->window_next<p->window_count && ssd1306_window_async(p))
+        return;
+
+    p->window_count=0;
+    p->busy=false;
+    if(p->flush_cb)
+        p->flush_cb(p, p->flush_ctx);
+}
 
-    *(p->buffer-1)=0x40;
+void ssd1306_transport_failed(ssd1306_transport_t *t) {
+    ssd1306_t *p=t->owner;
+
+    // the windows left would go to a display that does not answer
+    if(p)
+        p->window_next=p->window_count;
+    ssd1306_transport_done(t);
+}
+
+static bool ssd1306_front_setup(ssd1306_t *p) {
+#ifdef SSD1306_STATIC_GEOMETRY
+    p->front=p->front_storage;
+#else
+    if(!p->front && (p->front=malloc(DISP_BUFSIZE(p)+1))==NULL)
+        return false;
+#endif
+    return true;
+}
+
+bool ssd1306_show_async(ssd1306_t *p, ssd1306_flush_cb_t cb, void *ctx) {
+    ssd1306_show_wait(p);
+
+    if(p->scrolling) {
+        if(cb)
+            cb(p, ctx);
+        return true;
+    }
+
+    if(!p->transport->ops->write_data_async || !ssd1306_front_setup(p)) {
+        ssd1306_show(p);
+        if(cb)
+            cb(p, ctx);
+        return false;
+    }
+
+    // one window per page as in ssd1306_show, and the window around all of them
+    ssd1306_window_t all= {0xff, 0, 0xff, 0};
+    size_t cost=0;
+    p->window_count=0;
+    for(uint8_t page=0; page<DISP_PAGES(p); ++page) {
+        const uint8_t x0=p->dirty_x0[page];
+        const uint8_t x1=p->dirty_x1[page];
+
+        if(x0>x1)
+            continue;
+
+        uint8_t last=page;
+        if(x0==0 && x1==DISP_WIDTH(p)-1) {
+            while(last+1<DISP_PAGES(p) && p->dirty_x0[last+1]==0 && p->dirty_x1[last+1]==DISP_WIDTH(p)-1)
+                ++last;
+        }
+
+        ssd1306_window_t *w=&p->windows[p->window_count++];
+        w->x0=x0;
+        w->x1=x1;
+        w->page0=page;
+        w->page1=last;
+        cost+=ssd1306_window_len(w)+SSD1306_WINDOW_COST;
+
+        if(x0<all.x0)
+            all.x0=x0;
+        if(x1>all.x1)
+            all.x1=x1;
+        if(page<all.page0)
+            all.page0=page;
+        all.page1=last;
+        page=last;
+    }
+
+    if(!p->window_count) {
+        ssd1306_count_flush(p, 0);
+        if(cb)
+            cb(p, ctx);
+        return true;
+    }
+
+    if(ssd1306_window_len(&all)+SSD1306_WINDOW_COST<cost) {
+        p->windows[0]=all;
+        p->window_count=1;
+    }
+
+#ifdef SSD1306_CAPTURE
+    if(p->capture)
+        ssd1306_capture_frame(p->capture, p);
+#endif
+
+    // snapshot the windows into the front buffer, the back buffer is free after this
+    uint8_t *d=p->front+1;
+    for(uint8_t i=0; i<p->window_count; ++i) {
+        const ssd1306_window_t *w=&p->windows[i];
+
+        for(uint8_t page=w->page0; page<=w->page1; ++page) {
+            memcpy(d, p->buffer+page*DISP_WIDTH(p)+w->x0, w->x1-w->x0+1);
+            d+=w->x1-w->x0+1;
+        }
+    }
+
+    ssd1306_mark_clean(p);
+    ssd1306_count_flush(p, d-(p->front+1));
+
+    return ssd1306_windows_start(p, p->front+1, cb, ctx);
+}
+
+bool ssd1306_show_window_async(ssd1306_t *p, uint8_t *data, uint32_t x0, uint32_t x1, uint32_t page0, uint32_t page1, ssd1306_flush_cb_t cb, void *ctx) {
+    ssd1306_show_wait(p);
+
+    if(p->scrolling) {
+        if(cb)
+            cb(p, ctx);
+        return true;
+    }
+
+    // the window travels with the data, so a flush never waits for a shared bus
+    p->windows[0]=(ssd1306_window_t) {x0, x1, page0, page1};
+    p->window_count=1;
+
+    return ssd1306_windows_start(p, data, cb, ctx);
+}
+
+bool ssd1306_show_busy(ssd1306_t *p) {
+    // the transport is asked even while a flush runs, that is where its deadline is checked
+    const bool bus=p->transport->ops->busy(p->transport);
+    return p->busy || bus;
+}
 
-    fancy_write(p->i2c_i, p->address, p->buffer-1, p->bufsize+1, "ssd1306_show");
+void ssd1306_show_wait(ssd1306_t *p) {
+    while(ssd1306_show_busy(p))
+        tight_loop_contents();
 }
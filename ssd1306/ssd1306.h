@@ -32,6 +32,12 @@ SOFTWARE.
 #define _inc_ssd1306
 #include <pico/stdlib.h>
 #include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
 *	@brief defines commands used in ssd1306
@@ -53,22 +59,197 @@ typedef enum {
     SET_DISP_CLK_DIV = 0xD5,
     SET_PRECHARGE = 0xD9,
     SET_VCOM_DESEL = 0xDB,
-    SET_CHARGE_PUMP = 0x8D
+    SET_CHARGE_PUMP = 0x8D,
+    SET_HSCROLL_RIGHT = 0x26,
+    SET_HSCROLL_LEFT = 0x27,
+    SET_VHSCROLL_RIGHT = 0x29,
+    SET_VHSCROLL_LEFT = 0x2A,
+    SET_SCROLL_OFF = 0x2E,
+    SET_SCROLL_ON = 0x2F,
+    SET_VSCROLL_AREA = 0xA3
 } ssd1306_command_t;
 
 /**
-*	@brief holds the configuration
+*	@brief time between two scroll steps, in frames
+*
+*	values are the ones the controller expects, they are not ordered by speed.
+*/
+typedef enum {
+    SSD1306_SCROLL_2_FRAMES = 0x07,
+    SSD1306_SCROLL_3_FRAMES = 0x04,
+    SSD1306_SCROLL_4_FRAMES = 0x05,
+    SSD1306_SCROLL_5_FRAMES = 0x00,
+    SSD1306_SCROLL_25_FRAMES = 0x06,
+    SSD1306_SCROLL_64_FRAMES = 0x01,
+    SSD1306_SCROLL_128_FRAMES = 0x02,
+    SSD1306_SCROLL_256_FRAMES = 0x03
+} ssd1306_scroll_speed_t;
+
+/**
+*	@brief maximum number of pages supported (64 pixel high displays)
+*/
+#define SSD1306_MAX_PAGES 8
+
+/**
+*	@brief command bytes of an address window, see ssd1306_window_commands
+*/
+#define SSD1306_WINDOW_CMDS 6
+
+/**
+*	@brief maximum number of commands sent in one i2c transaction by ssd1306_write_cmds
+*/
+#define SSD1306_CMD_BATCH_MAX 32
+
+/**
+*	@brief flush statistics, updated by ssd1306_show
+*/
+typedef struct {
+    uint32_t flushes;			/**< number of calls to ssd1306_show */
+    uint32_t skipped;			/**< flushes skipped because nothing changed */
+    uint32_t bytes_sent;		/**< framebuffer bytes sent in total */
+    uint32_t bytes_saved;		/**< framebuffer bytes not sent thanks to dirty tracking */
+    uint16_t last_bytes_sent;	/**< framebuffer bytes sent by the last flush */
+    uint16_t last_bytes_saved;	/**< framebuffer bytes saved by the last flush */
+    uint32_t transactions;		/**< i2c transactions issued (commands and data) */
+    uint32_t init_us;			/**< time spent sending the init sequence */
+} ssd1306_stats_t;
+
+/**
+*	@brief builtin font, 8 pixels high and 5 wide (see font.h)
+*/
+extern const uint8_t font_8x5[];
+
+/**
+*	@brief bytes of atlas storage needed for count glyphs of a font width font_width at scale
+*/
+#define SSD1306_ATLAS_BYTES(count, font_width, scale) ((count)*(font_width)*(scale)*((scale)+1))
+
+/**
+*	@brief pre-rendered glyphs in page format, see ssd1306_atlas_init
+*/
+typedef struct {
+    uint8_t first;		/**< first char in the atlas */
+    uint8_t count;		/**< number of glyphs */
+    uint8_t width;		/**< columns per glyph */
+    uint8_t pages;		/**< pages spanned by every glyph */
+    uint8_t mask[5];	/**< rows covered by the glyphs in each page */
+    uint8_t *data;		/**< glyph bytes, pages*width per glyph, page after page */
+} ssd1306_atlas_t;
+
+typedef struct ssd1306 ssd1306_t;
+struct ssd1306_capture;
+
+/**
+*	@brief columns x0..x1 of pages page0..page1 in display ram
 */
 typedef struct {
+    uint8_t x0;		/**< first column */
+    uint8_t x1;		/**< last column */
+    uint8_t page0;	/**< first page */
+    uint8_t page1;	/**< last page */
+} ssd1306_window_t;
+
+/**
+*	@brief called when an asynchronous flush has been handed to the bus
+*
+*	runs in interrupt context.
+*/
+typedef void (*ssd1306_flush_cb_t)(ssd1306_t *p, void *ctx);
+
+#if defined(SSD1306_STATIC_WIDTH) && defined(SSD1306_STATIC_HEIGHT)
+/**
+*	@brief driver built for a single panel geometry
+*
+*	define SSD1306_STATIC_WIDTH and SSD1306_STATIC_HEIGHT to turn width,
+*	height and buffer size into constants and to keep the buffers inside
+*	ssd1306_t instead of on the heap. ssd1306_init fails for any other size.
+*/
+#define SSD1306_STATIC_GEOMETRY 1
+#define SSD1306_STATIC_PAGES (SSD1306_STATIC_HEIGHT/8)
+#define SSD1306_STATIC_BUFSIZE (SSD1306_STATIC_WIDTH*SSD1306_STATIC_PAGES)
+#endif
+
+/**
+*	@brief init command sequence for a display of the given size
+*/
+#define SSD1306_INIT_SEQUENCE(width, height, external_vcc) \
+    SET_DISP, \
+    SET_SCROLL_OFF,                 /* a scroll survives an mcu reset */ \
+    /* timing and driving scheme */ \
+    SET_DISP_CLK_DIV, \
+    0x80, \
+    SET_MUX_RATIO, \
+    (height)-1, \
+    SET_DISP_OFFSET, \
+    0x00, \
+    /* resolution and layout */ \
+    SET_DISP_START_LINE, \
+    /* charge pump */ \
+    SET_CHARGE_PUMP, \
+    (external_vcc)?0x10:0x14, \
+    SET_SEG_REMAP|0x01,             /* column addr 127 mapped to SEG0 */ \
+    SET_COM_OUT_DIR|0x08,           /* scan from COM[N] to COM0 */ \
+    SET_COM_PIN_CFG, \
+    (width)>2*(height)?0x02:0x12, \
+    /* display */ \
+    SET_CONTRAST, \
+    0xff, \
+    SET_PRECHARGE, \
+    (external_vcc)?0x22:0xF1, \
+    SET_VCOM_DESEL, \
+    0x30,                           /* or 0x40? */ \
+    SET_ENTIRE_ON,                  /* output follows RAM contents */ \
+    SET_NORM_INV,                   /* not inverted */ \
+    SET_DISP|0x01, \
+    /* address setting */ \
+    SET_MEM_ADDR, \
+    0x00                            /* horizontal */
+
+/**
+*	@brief holds the configuration
+*/
+struct ssd1306 {
     uint8_t width; 		/**< width of display */
     uint8_t height; 	/**< height of display */
     uint8_t pages;		/**< stores pages of display (calculated on initialization*/
-    uint8_t address; 	/**< i2c address of display*/
-    i2c_inst_t *i2c_i; 	/**< i2c connection instance */
+    ssd1306_transport_t *transport;	/**< bus the display is on */
     bool external_vcc; 	/**< whether display uses external vcc */ 
     uint8_t *buffer;	/**< display buffer */
     size_t bufsize;		/**< buffer size */
-} ssd1306_t;
+    uint8_t dirty_x0[SSD1306_MAX_PAGES];	/**< first changed column per page (x0>x1 means clean) */
+    uint8_t dirty_x1[SSD1306_MAX_PAGES];	/**< last changed column per page */
+    ssd1306_stats_t stats;	/**< flush statistics */
+    uint8_t *front;		/**< frame on the bus, front[0] is scratch for the transport (allocated by the first async flush) */
+    volatile bool busy;	/**< async flush in progress */
+    bool scrolling;		/**< hardware scroll running, flushes are held back */
+    ssd1306_window_t windows[SSD1306_MAX_PAGES];	/**< windows of the running async flush, sent one after the other */
+    uint8_t window_count;	/**< number of windows in windows */
+    uint8_t window_next;	/**< next window to hand to the transport */
+    uint8_t *window_data;	/**< data of the next window */
+    ssd1306_flush_cb_t flush_cb;	/**< completion callback of the running async flush */
+    void *flush_ctx;	/**< argument of flush_cb */
+#ifdef SSD1306_CAPTURE
+    struct ssd1306_capture *capture;	/**< capture tap fed by every flush, see capture.h, NULL if none */
+#endif
+#ifdef SSD1306_STATIC_GEOMETRY
+    uint8_t storage[SSD1306_STATIC_BUFSIZE+1];			/**< buffer memory, first byte is the 0x40 control byte */
+    uint8_t front_storage[SSD1306_STATIC_BUFSIZE+1];	/**< front buffer memory */
+#endif
+};
+
+/**
+*	@brief initialize display on a transport
+*
+*	@param[in] p : pointer to instance of ssd1306_t
+*	@param[in] width : width of display
+*	@param[in] height : heigth of display
+*	@param[in] transport : bus the display is on, see transport.h
+*	
+* 	@return bool.
+*	@retval true for Success
+*	@retval false if initialization failed
+*/
+bool ssd1306_init_transport(ssd1306_t *p, uint16_t width, uint16_t height, ssd1306_transport_t *transport);
 
 /**
 *	@brief initialize display
@@ -78,6 +259,9 @@ typedef struct {
 *	@param[in] height : heigth of display
 *	@param[in] address : i2c address of display
 *	@param[in] i2c_instance : instance of i2c connection
+*
+*	uses a builtin i2c transport, so only one display can be set up this
+*	way; use ssd1306_init_transport for more.
 *	
 * 	@return bool.
 *	@retval true for Success
@@ -85,14 +269,43 @@ typedef struct {
 */
 bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance);
 
+/**
+*	@brief send a command sequence
+*
+*	all commands (and their arguments) go out in one transaction; on i2c
+*	behind a single 0x00 control byte instead of one transaction per byte.
+*
+*	@param[in] p : instance of display
+*	@param[in] cmds : command bytes
+*	@param[in] len : number of command bytes
+*/
+void ssd1306_write_cmds(ssd1306_t *p, const uint8_t *cmds, size_t len);
+
 /**
 *	@brief deinitialize display
 *
+*	waits for the flush on the bus and releases the transport: an i2c
+*	display leaves the arbiter of its controller, so p may be reused.
+*
 *	@param[in] p : instance of display
 *
 */
 void ssd1306_deinit(ssd1306_t *p);
 
+/**
+*	@brief send the init sequence again
+*
+*	for a display that lost power or stopped answering. the transport
+*	tries again even if it had given up on the display, and the whole
+*	buffer is sent by the next flush.
+*
+*	@param[in] p : instance of display
+*
+*	@return true if the display took the init sequence
+*
+*/
+bool ssd1306_reset(ssd1306_t *p);
+
 /**
 *	@brief turn off display
 *
@@ -127,14 +340,251 @@ void ssd1306_contrast(ssd1306_t *p, uint8_t val);
 */
 void ssd1306_invert(ssd1306_t *p, uint8_t inv);
 
+/**
+	@brief start scrolling pages horizontally in hardware
+
+	pending changes are flushed first, then the controller keeps moving
+	the pages on its own without any bus traffic. while scrolling,
+	ssd1306_show and ssd1306_show_async only collect changes, they are
+	sent after ssd1306_scroll_stop.
+
+	@param[in] p : instance of display
+	@param[in] left : scroll to the left instead of to the right
+	@param[in] start_page : first page to scroll
+	@param[in] end_page : last page to scroll
+	@param[in] speed : time between two one-column steps
+
+*/
+void ssd1306_scroll_horizontal(ssd1306_t *p, bool left, uint8_t start_page, uint8_t end_page, ssd1306_scroll_speed_t speed);
+
+/**
+	@brief start scrolling pages horizontally and the whole display vertically
+
+	same as ssd1306_scroll_horizontal, the display also moves up by
+	vertical_offset rows on every step.
+
+	@param[in] p : instance of display
+	@param[in] left : scroll to the left instead of to the right
+	@param[in] start_page : first page to scroll horizontally
+	@param[in] end_page : last page to scroll horizontally
+	@param[in] speed : time between two steps
+	@param[in] vertical_offset : rows moved per step, 0 to 63
+
+*/
+void ssd1306_scroll_diagonal(ssd1306_t *p, bool left, uint8_t start_page, uint8_t end_page, ssd1306_scroll_speed_t speed, uint8_t vertical_offset);
+
+/**
+	@brief stop a hardware scroll
+
+	horizontal scrolling moves the display ram, so the whole buffer is
+	marked dirty and sent again by the next flush.
+
+	@param[in] p : instance of display
+
+*/
+void ssd1306_scroll_stop(ssd1306_t *p);
+
+/**
+	@brief set the ram row shown on the top line of the display
+
+	moves the picture up by line rows, wrapping around. the display ram
+	is not touched, so this costs a single command byte.
+
+	@param[in] p : instance of display
+	@param[in] line : ram row shown first, 0 to height-1
+
+*/
+void ssd1306_set_start_line(ssd1306_t *p, uint8_t line);
+
 /**
 	@brief display buffer, should be called on change
 
+	only the column ranges changed since the last call are sent, one
+	window per page; nothing is sent if the buffer did not change.
+
 	@param[in] p : instance of display
 
 */
 void ssd1306_show(ssd1306_t *p);
 
+/**
+	@brief send part of one page right away, bypassing dirty tracking
+
+	for layers that know exactly what changed, like the tile map. dirty
+	marks are left alone, so a later ssd1306_show still sends them. counts
+	as a flush in the statistics and feeds a capture tap like one; the tap
+	takes the whole framebuffer, dirty parts not sent yet included.
+
+	@param[in] p : instance of display
+	@param[in] page : page to send
+	@param[in] x : first column
+	@param[in] width : number of columns
+
+*/
+void ssd1306_show_span(ssd1306_t *p, uint32_t page, uint32_t x, uint32_t width);
+
+/**
+	@brief display buffer without blocking
+
+	copies the changed columns of every page of the buffer (the back
+	buffer) into the front buffer and lets the transport send them in the
+	background (by dma on i2c and spi), so the buffer can be drawn on again
+	right after this returns. the windows are the ones of ssd1306_show,
+	each started from the completion of the one before; a single window
+	around all changes is sent instead when that is fewer bytes on the bus. waits for a previous async flush that is still running.
+	sends blocking if the transport cannot send in the background.
+	displays on different i2c controllers flush at the same time, displays
+	sharing a controller take turns every SSD1306_I2C_CHUNK bytes.
+
+	@param[in] p : instance of display
+	@param[in] cb : called when the data has been sent (on i2c: after the last stop), may be NULL
+	@param[in] ctx : argument passed to cb
+
+	@return bool.
+	@retval true if the flush was started (or there was nothing to send)
+	@retval false if it had to be done blocking
+*/
+bool ssd1306_show_async(ssd1306_t *p, ssd1306_flush_cb_t cb, void *ctx);
+
+/**
+	@brief send a window of display data from memory of the caller without blocking
+
+	the framebuffer and its dirty marks are left alone. for layers that
+	build what the display shows elsewhere, like the grayscale planes.
+	waits for a previous async flush that is still running. nothing is
+	sent while the display scrolls in hardware.
+
+	@param[in] p : instance of display
+	@param[in] data : columns x0..x1 of pages page0..page1, page after page; data[-1] may be borrowed by the transport. must stay untouched until cb
+	@param[in] x0 : first column
+	@param[in] x1 : last column
+	@param[in] page0 : first page
+	@param[in] page1 : last page
+	@param[in] cb : called when the data has been sent, may be NULL
+	@param[in] ctx : argument passed to cb
+
+	@return bool.
+	@retval true if the flush was started (or the display scrolls)
+	@retval false if it had to be done blocking
+*/
+bool ssd1306_show_window_async(ssd1306_t *p, uint8_t *data, uint32_t x0, uint32_t x1, uint32_t page0, uint32_t page1, ssd1306_flush_cb_t cb, void *ctx);
+
+/**
+	@brief poll for an async flush to finish
+
+	@param[in] p : instance of display
+
+	@return true while data of an async flush is still being sent
+*/
+bool ssd1306_show_busy(ssd1306_t *p);
+
+/**
+	@brief wait for an async flush to finish
+
+	@param[in] p : instance of display
+*/
+void ssd1306_show_wait(ssd1306_t *p);
+
+/**
+	@brief commands that point the display ram at a window
+
+	columns x0..x1 of pages page0..page1; data written afterwards fills
+	the window page after page. 64 pixel wide panels are wired to the
+	middle columns of the controller, the offset is added here.
+
+	@param[out] cmds : SSD1306_WINDOW_CMDS command bytes
+	@param[in] width : width of display
+	@param[in] x0 : first column
+	@param[in] x1 : last column
+	@param[in] page0 : first page
+	@param[in] page1 : last page
+*/
+void ssd1306_window_commands(uint8_t *cmds, uint32_t width, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1);
+
+/**
+	@brief clip a line to a display of the given size
+
+	both end points are moved onto the display along the line, in integer
+	math. ssd1306_draw_line clips this way, so other renderers that clip
+	with it first and then step the same bresenham agree on every pixel.
+
+	@param[in] width : width of display
+	@param[in] height : height of display
+	@param[in,out] x1 : x position of starting point
+	@param[in,out] y1 : y position of starting point
+	@param[in,out] x2 : x position of end point
+	@param[in,out] y2 : y position of end point
+
+	@return false if the line misses the display entirely
+*/
+bool ssd1306_clip_line(uint32_t width, uint32_t height, int32_t *x1, int32_t *y1, int32_t *x2, int32_t *y2);
+
+/**
+	@brief mark an area of the buffer as changed
+
+	needed only when writing to p->buffer directly; all drawing
+	functions of this driver already keep track of what they touch.
+
+	@param[in] p : instance of display
+	@param[in] x : x position of starting point
+	@param[in] y : y position of starting point
+	@param[in] width : width of area
+	@param[in] height : height of area
+*/
+void ssd1306_mark_dirty(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/**
+	@brief mark the whole buffer as sent
+
+	for layers that put the buffer on the display by other means, e.g.
+	gray.h, so the next flush does not send it again.
+
+	@param[in] p : instance of display
+*/
+void ssd1306_mark_clean(ssd1306_t *p);
+
+/**
+	@brief tell if any part of the buffer changed since the last flush
+
+	@param[in] p : instance of display
+
+	@return true if the next flush has something to send
+*/
+bool ssd1306_is_dirty(const ssd1306_t *p);
+
+/**
+	@brief count a flush in the statistics of the display
+
+	for layers that send to the display around ssd1306_show, like
+	ssd1306_image_send. the transactions they issue are counted apart.
+
+	@param[in] p : instance of display
+	@param[in] sent : data bytes sent
+*/
+void ssd1306_count_flush(ssd1306_t *p, size_t sent);
+
+/**
+	@brief get flush statistics
+
+	@param[in] p : instance of display
+
+	@return pointer to the statistics of the display
+*/
+const ssd1306_stats_t *ssd1306_get_stats(const ssd1306_t *p);
+
+/**
+	@brief bus health of the display
+
+	transfer, failure, retry, timeout and recovery counters plus transfer
+	latencies of the transport, so the app can tell a missing or flaky
+	display apart and degrade gracefully.
+
+	@param[in] p : instance of display
+
+	@return the counters of the transport, updated in place
+*/
+const ssd1306_bus_stats_t *ssd1306_bus_stats(const ssd1306_t *p);
+
 /**
 	@brief clear display buffer
 
@@ -194,6 +644,42 @@ void ssd1306_clear_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width,
 */
 void ssd1306_draw_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 
+/**
+	@brief fill rectangle, working on whole page bytes
+
+	@param[in] p : instance of display
+	@param[in] x : x position of starting point
+	@param[in] y : y position of starting point
+	@param[in] width : width of rectangle
+	@param[in] height : height of rectangle
+*/
+void ssd1306_fill_rect(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/**
+	@brief clear rectangle, working on whole page bytes
+
+	@param[in] p : instance of display
+	@param[in] x : x position of starting point
+	@param[in] y : y position of starting point
+	@param[in] width : width of rectangle
+	@param[in] height : height of rectangle
+*/
+void ssd1306_clear_rect(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/**
+	@brief invert (xor) rectangle, working on whole page bytes
+
+	calling it twice with the same arguments restores the buffer, which
+	makes it suitable for highlights and cursors.
+
+	@param[in] p : instance of display
+	@param[in] x : x position of starting point
+	@param[in] y : y position of starting point
+	@param[in] width : width of rectangle
+	@param[in] height : height of rectangle
+*/
+void ssd1306_invert_rect(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
 /**
 	@brief draw empty square at given position with given size
 
@@ -228,6 +714,9 @@ void ssd1306_bmp_show_image(ssd1306_t *p, const uint8_t *data, const long size);
 /**
 	@brief draw char with given font
 
+	fonts up to 8 pixels high drawn at scale 1 to 4 are blitted a column
+	byte at a time; other fonts and scales are drawn pixel by pixel.
+
 	@param[in] p : instance of display
 	@param[in] x : x starting position of char
 	@param[in] y : y starting position of char
@@ -248,6 +737,42 @@ void ssd1306_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t
 */
 void ssd1306_draw_char(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale, char c);
 
+/**
+	@brief render glyphs into an atlas of page-format bitmaps
+
+	every glyph is rendered once, already shifted to the row it will be
+	drawn at inside a page, so drawing it later is a plain byte copy.
+	only fonts up to 8 pixels high are supported.
+
+	@param[out] a : atlas to fill
+	@param[in] font : pointer to font
+	@param[in] scale : scale of the glyphs (1-4)
+	@param[in] y_shift : y position of the glyphs inside their first page (0-7)
+	@param[in] first : first char to render
+	@param[in] last : last char to render
+	@param[in] storage : glyph memory, at least SSD1306_ATLAS_BYTES(last-first+1, font width, scale) bytes
+	@param[in] storage_size : size of storage in bytes
+
+	@return bool.
+	@retval true for Success
+	@retval false if the font, scale or storage size is not supported
+*/
+bool ssd1306_atlas_init(ssd1306_atlas_t *a, const uint8_t *font, uint32_t scale, uint32_t y_shift, char first, char last, uint8_t *storage, size_t storage_size);
+
+/**
+	@brief copy a glyph from an atlas into the buffer
+
+	the rows covered by the glyph are replaced, other rows of the pages
+	are kept.
+
+	@param[in] p : instance of display
+	@param[in] a : atlas
+	@param[in] x : x starting position of char
+	@param[in] page : first page of char (its y position is page*8+y_shift)
+	@param[in] c : character to draw
+*/
+void ssd1306_atlas_draw_char(ssd1306_t *p, const ssd1306_atlas_t *a, uint32_t x, uint32_t page, char c);
+
 /**
 	@brief draw string with given font
 
@@ -271,4 +796,8 @@ void ssd1306_draw_string_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_
 */
 void ssd1306_draw_string(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale, const char *s);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,170 @@
+/**
+* @file ssd1306.hpp
+*
+* compile time specialized c++ front end of the ssd1306 driver
+*
+* geometry is a template parameter, so every pixel address is computed
+* from constants. the buffer lives inside the instance (declare it static
+* or global, no heap is used) and flushing, text and shapes are done by
+* the c driver on the same buffer. the c driver must be built for the
+* same geometry (SSD1306_STATIC_WIDTH/SSD1306_STATIC_HEIGHT).
+*/
+
+#ifndef _inc_ssd1306_hpp
+#define _inc_ssd1306_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ssd1306.h"
+
+#ifndef SSD1306_STATIC_GEOMETRY
+#error "Ssd1306<> needs the driver built with SSD1306_STATIC_WIDTH and SSD1306_STATIC_HEIGHT"
+#endif
+
+/**
+*	@brief i2c transport of a display
+*
+*	@tparam Index : i2c controller, 0 or 1
+*	@tparam Address : i2c address of display
+*/
+template <unsigned Index, uint8_t Address=0x3C>
+struct Ssd1306I2c {
+    static_assert(Index<2, "there are only i2c0 and i2c1");
+
+    static ssd1306_transport_t *transport() {
+        static ssd1306_i2c_t t;
+        return ssd1306_i2c_init(&t, Index?i2c1:i2c0, Address);
+    }
+};
+
+/**
+*	@brief 4-wire spi transport of a display
+*
+*	@tparam Index : spi controller, 0 or 1
+*	@tparam Cs : chip select gpio
+*	@tparam Dc : data/command gpio
+*	@tparam Rst : reset gpio, -1 if not connected
+*/
+template <unsigned Index, unsigned Cs, unsigned Dc, int Rst=-1>
+struct Ssd1306Spi {
+    static_assert(Index<2, "there are only spi0 and spi1");
+
+    static ssd1306_transport_t *transport() {
+        static ssd1306_spi_t t;
+        return ssd1306_spi_init(&t, Index?spi1:spi0, Cs, Dc, Rst);
+    }
+};
+
+/**
+*	@brief display with geometry fixed at compile time
+*
+*	@tparam W : width of display
+*	@tparam H : height of display
+*	@tparam Transport : bus the display is on, e.g. Ssd1306I2c<1> or Ssd1306Spi<0, 17, 20>
+*	@tparam ExternalVcc : whether display uses external vcc
+*/
+template <uint8_t W, uint8_t H, class Transport, bool ExternalVcc=false>
+class Ssd1306 {
+public:
+    static constexpr uint8_t width=W;
+    static constexpr uint8_t height=H;
+    static constexpr uint8_t pages=H/8;
+    static constexpr size_t bufsize=size_t(W)*pages;
+
+    /**
+    *	@brief init sequence, as sent by ssd1306_init
+    */
+    static constexpr uint8_t init_cmds[]= {SSD1306_INIT_SEQUENCE(W, H, ExternalVcc)};
+
+    static_assert(H%8==0 && pages<=SSD1306_MAX_PAGES, "height must be a multiple of 8, at most 64");
+    static_assert(W==SSD1306_STATIC_WIDTH && H==SSD1306_STATIC_HEIGHT, "the c driver is built for another geometry");
+    static_assert(bufsize==SSD1306_STATIC_BUFSIZE, "buffer size mismatch");
+
+    /**
+    *	@brief initialize display
+    *
+    *	@return true for Success
+    */
+    bool init() {
+        disp_.external_vcc=ExternalVcc;
+        return ssd1306_init_transport(&disp_, W, H, Transport::transport());
+    }
+
+    void draw_pixel(uint32_t x, uint32_t y) {
+        if(x>=W || y>=H) return;
+
+        uint8_t &b=disp_.buffer[x+W*(y>>3)];
+        const uint8_t v=b|(1u<<(y&7));
+        if(v!=b) {
+            b=v;
+            mark(y>>3, x);
+        }
+    }
+
+    void clear_pixel(uint32_t x, uint32_t y) {
+        if(x>=W || y>=H) return;
+
+        uint8_t &b=disp_.buffer[x+W*(y>>3)];
+        const uint8_t v=b&~(1u<<(y&7));
+        if(v!=b) {
+            b=v;
+            mark(y>>3, x);
+        }
+    }
+
+    void clear() {
+        ssd1306_clear(&disp_);
+    }
+
+    void show() {
+        ssd1306_show(&disp_);
+    }
+
+    bool show_async(ssd1306_flush_cb_t cb=nullptr, void *ctx=nullptr) {
+        return ssd1306_show_async(&disp_, cb, ctx);
+    }
+
+    void fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+        ssd1306_fill_rect(&disp_, x, y, w, h);
+    }
+
+    void clear_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+        ssd1306_clear_rect(&disp_, x, y, w, h);
+    }
+
+    void invert_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+        ssd1306_invert_rect(&disp_, x, y, w, h);
+    }
+
+    void draw_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+        ssd1306_draw_line(&disp_, x1, y1, x2, y2);
+    }
+
+    void draw_string(uint32_t x, uint32_t y, uint32_t scale, const char *s) {
+        ssd1306_draw_string(&disp_, x, y, scale, s);
+    }
+
+    uint8_t *buffer() {
+        return disp_.buffer;
+    }
+
+    /**
+    *	@brief the c instance, for any function not wrapped here
+    */
+    ssd1306_t *c_handle() {
+        return &disp_;
+    }
+
+private:
+    void mark(uint32_t page, uint32_t x) {
+        if(x<disp_.dirty_x0[page])
+            disp_.dirty_x0[page]=x;
+        if(x>disp_.dirty_x1[page])
+            disp_.dirty_x1[page]=x;
+    }
+
+    ssd1306_t disp_;
+};
+
+#endif
@@ -0,0 +1,100 @@
+/**
+* @file tilemap.c
+*
+* tile map: cells compared with the map as last copied, changed runs
+* copied (or cleared) into the framebuffer and sent or marked dirty
+*/
+
+#include <pico/stdlib.h>
+#include <string.h>
+
+#include "tilemap.h"
+
+void ssd1306_tile_from_char(uint8_t *tile, const uint8_t *font, char c) {
+    memset(tile, 0, SSD1306_TILE_BYTES);
+
+    if((uint8_t) c<font[3] || (uint8_t) c>font[4])
+        return;
+
+    const uint8_t *glyph=&font[((uint8_t) c-font[3])*font[1]+5];
+    for(uint32_t w=0; w<font[1] && w+1<SSD1306_TILE_BYTES; ++w)
+        tile[w+1]=glyph[w];
+}
+
+void ssd1306_tilemap_init(ssd1306_tilemap_t *m, ssd1306_t *p, const uint8_t *bank, uint8_t count) {
+    m->disp=p;
+    m->bank=bank;
+    m->count=count;
+    m->cols=p->width/8;
+    m->rows=p->height/8;
+    m->valid=false;
+    memset(m->map, SSD1306_TILE_NONE, sizeof(m->map));
+    memset(m->shown, SSD1306_TILE_NONE, sizeof(m->shown));
+}
+
+void ssd1306_tilemap_set(ssd1306_tilemap_t *m, uint32_t col, uint32_t row, uint8_t tile) {
+    if(col>=m->cols || row>=m->rows) return;
+
+    m->map[row*m->cols+col]=tile<m->count?tile:SSD1306_TILE_NONE;
+}
+
+void ssd1306_tilemap_set_row(ssd1306_tilemap_t *m, uint32_t col, uint32_t row, const uint8_t *tiles, uint32_t len) {
+    for(uint32_t i=0; i<len; ++i)
+        ssd1306_tilemap_set(m, col+i, row, tiles[i]);
+}
+
+void ssd1306_tilemap_invalidate(ssd1306_tilemap_t *m) {
+    m->valid=false;
+}
+
+inline static bool ssd1306_tile_changed(const ssd1306_tilemap_t *m, uint32_t i) {
+    if(m->map[i]==SSD1306_TILE_NONE)
+        return m->valid && m->shown[i]!=SSD1306_TILE_NONE; // the old tile has to be cleared
+    return !m->valid || m->map[i]!=m->shown[i];
+}
+
+// copies changed cells into the framebuffer, runs of neighbouring cells are sent or marked dirty
+static size_t ssd1306_tilemap_update(ssd1306_tilemap_t *m, bool send) {
+    ssd1306_t *p=m->disp;
+    size_t changed=0;
+
+    for(uint32_t row=0; row<m->rows; ++row) {
+        const uint32_t base=row*m->cols;
+
+        for(uint32_t col=0; col<m->cols; ++col) {
+            if(!ssd1306_tile_changed(m, base+col)) {
+                m->shown[base+col]=m->map[base+col];
+                continue;
+            }
+
+            uint32_t end=col;
+            for(; end<m->cols && ssd1306_tile_changed(m, base+end); ++end) {
+                uint8_t *dst=p->buffer+row*p->width+end*8;
+
+                if(m->map[base+end]==SSD1306_TILE_NONE)
+                    memset(dst, 0, SSD1306_TILE_BYTES);
+                else
+                    memcpy(dst, m->bank+m->map[base+end]*SSD1306_TILE_BYTES, SSD1306_TILE_BYTES);
+                m->shown[base+end]=m->map[base+end];
+            }
+
+            if(send)
+                ssd1306_show_span(p, row, col*8, (end-col)*8);
+            else
+                ssd1306_mark_dirty(p, col*8, row*8, (end-col)*8, 8);
+            changed+=(end-col)*8;
+            col=end-1;
+        }
+    }
+
+    m->valid=true;
+    return changed;
+}
+
+size_t ssd1306_tilemap_flush(ssd1306_tilemap_t *m) {
+    return ssd1306_tilemap_update(m, true);
+}
+
+size_t ssd1306_tilemap_draw(ssd1306_tilemap_t *m) {
+    return ssd1306_tilemap_update(m, false);
+}
@@ -0,0 +1,133 @@
+/**
+* @file tilemap.h
+*
+* tile map layer on top of ssd1306_t: the screen is a grid of 8x8 cells,
+* each showing a tile of a tile bank. a flush compares the map with the
+* one flushed last time and sends only the tiles that changed. after a
+* full clear or image draw, see ssd1306_tilemap_invalidate.
+*/
+
+#ifndef _inc_ssd1306_tilemap
+#define _inc_ssd1306_tilemap
+#include <pico/stdlib.h>
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief cells per row on the widest display
+*/
+#define SSD1306_TILE_COLS_MAX 16
+
+/**
+*	@brief bytes per tile, one byte per column in page format
+*/
+#define SSD1306_TILE_BYTES 8
+
+/**
+*	@brief cell not managed by the tile map, the framebuffer shows through
+*/
+#define SSD1306_TILE_NONE 0xFF
+
+/**
+*	@brief tile map state
+*/
+typedef struct {
+    ssd1306_t *disp;		/**< display the tiles are drawn on */
+    const uint8_t *bank;	/**< tiles, SSD1306_TILE_BYTES each */
+    uint8_t count;			/**< tiles in bank */
+    uint8_t cols;			/**< cells per row */
+    uint8_t rows;			/**< rows of cells, one per page */
+    bool valid;				/**< shown describes what the display shows */
+    uint8_t map[SSD1306_MAX_PAGES*SSD1306_TILE_COLS_MAX];	/**< tile of every cell, row after row */
+    uint8_t shown[SSD1306_MAX_PAGES*SSD1306_TILE_COLS_MAX];	/**< map as of the last flush */
+} ssd1306_tilemap_t;
+
+/**
+*	@brief make a tile from a font glyph
+*
+*	the glyph is copied one column in from the left, columns past the
+*	tile are cut. fonts must be 8 pixels high.
+*
+*	@param[out] tile : SSD1306_TILE_BYTES bytes
+*	@param[in] font : pointer to font
+*	@param[in] c : character
+*/
+void ssd1306_tile_from_char(uint8_t *tile, const uint8_t *font, char c);
+
+/**
+*	@brief initialize a tile map with every cell set to SSD1306_TILE_NONE
+*
+*	@param[out] m : tile map
+*	@param[in] p : instance of display
+*	@param[in] bank : tiles, must stay valid while the map is used
+*	@param[in] count : tiles in bank, at most 255
+*/
+void ssd1306_tilemap_init(ssd1306_tilemap_t *m, ssd1306_t *p, const uint8_t *bank, uint8_t count);
+
+/**
+*	@brief set the tile of one cell
+*
+*	a cell set back to SSD1306_TILE_NONE is cleared by the next flush,
+*	after that the map leaves it to the framebuffer again.
+*
+*	@param[in] m : tile map
+*	@param[in] col : column of the cell
+*	@param[in] row : row of the cell
+*	@param[in] tile : tile index or SSD1306_TILE_NONE
+*/
+void ssd1306_tilemap_set(ssd1306_tilemap_t *m, uint32_t col, uint32_t row, uint8_t tile);
+
+/**
+*	@brief set the tiles of a row of cells
+*
+*	@param[in] m : tile map
+*	@param[in] col : first column
+*	@param[in] row : row of the cells
+*	@param[in] tiles : tile indices
+*	@param[in] len : number of cells
+*/
+void ssd1306_tilemap_set_row(ssd1306_tilemap_t *m, uint32_t col, uint32_t row, const uint8_t *tiles, uint32_t len);
+
+/**
+*	@brief copy changed tiles into the framebuffer and send them
+*
+*	cells that changed since the last flush are sent in runs of
+*	neighbouring cells, one window per run.
+*
+*	@param[in] m : tile map
+*
+*	@return framebuffer bytes sent
+*/
+size_t ssd1306_tilemap_flush(ssd1306_tilemap_t *m);
+
+/**
+*	@brief copy changed tiles into the framebuffer without sending them
+*
+*	the cells are marked dirty and go out with the next ssd1306_show or
+*	ssd1306_show_async, together with everything else drawn meanwhile.
+*
+*	@param[in] m : tile map
+*
+*	@return framebuffer bytes changed
+*/
+size_t ssd1306_tilemap_draw(ssd1306_tilemap_t *m);
+
+/**
+*	@brief forget what the display shows, the next flush sends every managed cell
+*
+*	the map only knows about the cells it copied itself. call this after
+*	anything else overwrites them in the framebuffer (ssd1306_clear,
+*	ssd1306_image_draw, a bmp), otherwise unchanged cells stay blank.
+*
+*	@param[in] m : tile map
+*/
+void ssd1306_tilemap_invalidate(ssd1306_tilemap_t *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
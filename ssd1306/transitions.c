@@ -0,0 +1,64 @@
+/**
+* @file transitions.c
+*
+* contrast fades and start line rolls, stepped against time_us_64
+*/
+
+#include <pico/stdlib.h>
+
+#include "transitions.h"
+
+static void ssd1306_transition_begin(ssd1306_transition_t *t, ssd1306_transition_kind_t kind, uint8_t from, uint8_t to, uint32_t duration_ms) {
+    t->kind=kind;
+    t->from=from;
+    t->to=to;
+    t->value=-1;
+    t->start_us=0;
+    t->duration_us=duration_ms*1000;
+}
+
+void ssd1306_fade_begin(ssd1306_transition_t *t, uint8_t from, uint8_t to, uint32_t duration_ms) {
+    ssd1306_transition_begin(t, SSD1306_TRANSITION_FADE, from, to, duration_ms);
+}
+
+void ssd1306_roll_begin(ssd1306_transition_t *t, bool up, uint8_t rows, uint32_t duration_ms) {
+    ssd1306_transition_begin(t, up?SSD1306_TRANSITION_ROLL_UP:SSD1306_TRANSITION_ROLL_DOWN, rows, 0, duration_ms);
+}
+
+static void ssd1306_transition_send(ssd1306_t *p, const ssd1306_transition_t *t, uint8_t value) {
+    if(t->kind==SSD1306_TRANSITION_FADE) {
+        ssd1306_contrast(p, value);
+        return;
+    }
+
+    // value is the distance from the rest position, start line 0
+    const uint8_t height=p->height;
+    const uint8_t line=value%height;
+    ssd1306_set_start_line(p, t->kind==SSD1306_TRANSITION_ROLL_UP?(height-line)%height:line);
+}
+
+bool ssd1306_transition_step(ssd1306_t *p, ssd1306_transition_t *t) {
+    const uint64_t now=time_us_64();
+
+    if(!t->start_us)
+        t->start_us=now;
+
+    const uint64_t elapsed=now-t->start_us;
+    const bool running=elapsed<t->duration_us;
+
+    int16_t value=t->to;
+    if(running)
+        value=t->from+(int64_t)(t->to-t->from)*(int64_t)elapsed/(int64_t)t->duration_us; // 255 steps times 8.4 s of us overflow 32 bits
+
+    if(value!=t->value) {
+        ssd1306_transition_send(p, t, value);
+        t->value=value;
+    }
+
+    return running;
+}
+
+void ssd1306_transition_run(ssd1306_t *p, ssd1306_transition_t *t) {
+    while(ssd1306_transition_step(p, t))
+        sleep_ms(SSD1306_FRAME_MS);
+}
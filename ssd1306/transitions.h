@@ -0,0 +1,89 @@
+/**
+* @file transitions.h
+*
+* screen transitions done by the controller: contrast ramps and rolls of
+* the display start line. a running transition only sends a command when
+* its value changes, the framebuffer is never resent.
+*/
+
+#ifndef _inc_ssd1306_transitions
+#define _inc_ssd1306_transitions
+#include <pico/stdlib.h>
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@brief approximate frame period of the panel with the default clock, in ms
+*/
+#define SSD1306_FRAME_MS 10
+
+typedef enum {
+    SSD1306_TRANSITION_FADE,	/**< contrast ramp */
+    SSD1306_TRANSITION_ROLL_UP,	/**< picture rolls up, ending at start line 0 */
+    SSD1306_TRANSITION_ROLL_DOWN	/**< picture rolls down, ending at start line 0 */
+} ssd1306_transition_kind_t;
+
+/**
+*	@brief state of a running transition
+*/
+typedef struct {
+    ssd1306_transition_kind_t kind;	/**< what is animated */
+    uint8_t from;			/**< first value: contrast, or rows away from the rest position */
+    uint8_t to;				/**< last value */
+    int16_t value;			/**< last value sent, -1 before the first step */
+    uint64_t start_us;		/**< time of the first step, 0 before the first step */
+    uint32_t duration_us;	/**< length of the transition */
+} ssd1306_transition_t;
+
+/**
+*	@brief prepare a contrast ramp
+*
+*	@param[out] t : transition
+*	@param[in] from : contrast at the start
+*	@param[in] to : contrast at the end
+*	@param[in] duration_ms : length of the ramp
+*/
+void ssd1306_fade_begin(ssd1306_transition_t *t, uint8_t from, uint8_t to, uint32_t duration_ms);
+
+/**
+*	@brief prepare a roll of the picture by moving the display start line
+*
+*	the picture moves by rows rows and ends where it was drawn. rows equal
+*	to the display height is one full turn.
+*
+*	@param[out] t : transition
+*	@param[in] up : roll up instead of down
+*	@param[in] rows : rows travelled, at most the display height
+*	@param[in] duration_ms : length of the roll
+*/
+void ssd1306_roll_begin(ssd1306_transition_t *t, bool up, uint8_t rows, uint32_t duration_ms);
+
+/**
+*	@brief advance a transition to the current time
+*
+*	sends at most one command, and only when the value changed since the
+*	last step. call it from the main loop as often as convenient.
+*
+*	@param[in] p : instance of display
+*	@param[in] t : transition
+*
+*	@return true while the transition is running, false once the last value was sent
+*/
+bool ssd1306_transition_step(ssd1306_t *p, ssd1306_transition_t *t);
+
+/**
+*	@brief run a transition to the end, blocking
+*
+*	@param[in] p : instance of display
+*	@param[in] t : transition
+*/
+void ssd1306_transition_run(ssd1306_t *p, ssd1306_transition_t *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
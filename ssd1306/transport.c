@@ -0,0 +1,168 @@
+/**
+* @file transport.c
+*
+* dma completion shared by all transports
+*/
+
+#include <pico/stdlib.h>
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include <string.h>
+
+#include "transport.h"
+
+static ssd1306_transport_t *dma_owner[NUM_DMA_CHANNELS]; // transport using each channel
+static uint8_t dma_sink; // where the drain channels throw the rx bytes
+
+void ssd1306_transport_setup(ssd1306_transport_t *t, const ssd1306_transport_ops_t *ops) {
+    t->ops=ops;
+    t->owner=NULL;
+    t->dma_channel=-1;
+    t->drain_channel=-1;
+    memset(&t->stats, 0, sizeof(t->stats));
+}
+
+static bool ssd1306_transport_account(ssd1306_transport_t *t, bool ok, uint32_t start) {
+    ssd1306_bus_stats_t *s=&t->stats;
+    const uint32_t us=time_us_32()-start;
+
+    ++s->writes;
+    s->last_us=us;
+    if(us>s->max_us)
+        s->max_us=us;
+    s->total_us+=us;
+
+    if(ok) {
+        s->consecutive_failures=0;
+    } else {
+        ++s->failures;
+        ++s->consecutive_failures;
+    }
+
+    return ok;
+}
+
+bool ssd1306_transport_write_cmds(ssd1306_transport_t *t, const uint8_t *cmds, size_t len) {
+    const uint32_t start=time_us_32();
+    return ssd1306_transport_account(t, t->ops->write_cmds(t, cmds, len), start);
+}
+
+bool ssd1306_transport_write_data(ssd1306_transport_t *t, uint8_t *data, size_t len) {
+    const uint32_t start=time_us_32();
+    return ssd1306_transport_account(t, t->ops->write_data(t, data, len), start);
+}
+
+static void ssd1306_transport_dma_irq_handler(void) {
+    for(uint ch=0; ch<NUM_DMA_CHANNELS; ++ch) {
+        ssd1306_transport_t *t=dma_owner[ch];
+
+        if(!t || !dma_channel_get_irq0_status(ch))
+            continue;
+
+        dma_channel_acknowledge_irq0(ch);
+        if(t->ops->dma_done)
+            t->ops->dma_done(t);
+        else
+            ssd1306_transport_done(t);
+    }
+}
+
+static void ssd1306_transport_dma_irq_install(void) {
+    static bool irq_installed=false;
+
+    if(irq_installed)
+        return;
+
+    irq_add_shared_handler(DMA_IRQ_0, ssd1306_transport_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    irq_installed=true;
+}
+
+bool ssd1306_transport_dma_claim(ssd1306_transport_t *t, uint dreq, volatile void *fifo, enum dma_channel_transfer_size size) {
+    if(t->dma_channel>=0)
+        return true;
+
+    const int ch=dma_claim_unused_channel(false);
+    if(ch<0)
+        return false;
+
+    ssd1306_transport_dma_irq_install();
+
+    dma_channel_config c=dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&c, size);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, dreq);
+    dma_channel_configure(ch, &c, fifo, NULL, 0, false);
+
+    dma_owner[ch]=t;
+    dma_channel_set_irq0_enabled(ch, t->drain_channel<0);
+    t->dma_channel=ch;
+
+    return true;
+}
+
+bool ssd1306_transport_dma_claim_drain(ssd1306_transport_t *t, uint dreq, const volatile void *fifo) {
+    if(t->drain_channel>=0)
+        return true;
+
+    const int ch=dma_claim_unused_channel(false);
+    if(ch<0)
+        return false;
+
+    ssd1306_transport_dma_irq_install();
+
+    dma_channel_config c=dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, dreq);
+    dma_channel_configure(ch, &c, &dma_sink, fifo, 0, false);
+
+    // the end of the transfer is the end of the drain, not of the tx channel
+    if(t->dma_channel>=0)
+        dma_channel_set_irq0_enabled(t->dma_channel, false);
+    dma_owner[ch]=t;
+    dma_channel_set_irq0_enabled(ch, true);
+    t->drain_channel=ch;
+
+    return true;
+}
+
+void ssd1306_transport_dma_start(ssd1306_transport_t *t, const void *src, uint32_t count) {
+    if(t->drain_channel>=0)
+        dma_channel_set_trans_count(t->drain_channel, count, true);
+    dma_channel_set_read_addr(t->dma_channel, src, false);
+    dma_channel_set_trans_count(t->dma_channel, count, true);
+}
+
+// an abort can raise the completion irq, keep it from reaching the handler
+static void ssd1306_transport_dma_channel_abort(int ch, bool irq) {
+    if(ch<0)
+        return;
+
+    dma_channel_set_irq0_enabled(ch, false);
+    dma_channel_abort(ch);
+    dma_channel_acknowledge_irq0(ch);
+    dma_channel_set_irq0_enabled(ch, irq);
+}
+
+void ssd1306_transport_dma_abort(ssd1306_transport_t *t) {
+    ssd1306_transport_dma_channel_abort(t->dma_channel, t->drain_channel<0);
+    ssd1306_transport_dma_channel_abort(t->drain_channel, true);
+}
+
+static void ssd1306_transport_dma_channel_release(int *ch) {
+    if(*ch<0)
+        return;
+
+    dma_channel_set_irq0_enabled(*ch, false);
+    dma_owner[*ch]=NULL;
+    dma_channel_unclaim(*ch);
+    *ch=-1;
+}
+
+void ssd1306_transport_dma_release(ssd1306_transport_t *t) {
+    ssd1306_transport_dma_channel_release(&t->dma_channel);
+    ssd1306_transport_dma_channel_release(&t->drain_channel);
+}
@@ -0,0 +1,327 @@
+/**
+* @file transport.h
+*
+* bus the display is attached to. the driver only talks to the display
+* through the ops of a transport, so drawing code does not care whether
+* it is i2c, spi or a mock.
+*/
+
+#ifndef _inc_ssd1306_transport
+#define _inc_ssd1306_transport
+#include <pico/stdlib.h>
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ssd1306;
+typedef struct ssd1306_transport ssd1306_transport_t;
+
+/**
+*	@brief operations of a transport
+*/
+typedef struct {
+    /** send command bytes, blocking */
+    bool (*write_cmds)(ssd1306_transport_t *t, const uint8_t *cmds, size_t len);
+    /** send display data, blocking. data[-1] may be used as scratch, it is restored before returning */
+    bool (*write_data)(ssd1306_transport_t *t, uint8_t *data, size_t len);
+    /** start sending cmds (the address window) and then display data in the background, call
+        ssd1306_transport_done when finished. data must stay untouched until then. NULL if the
+        transport can only block */
+    bool (*write_data_async)(ssd1306_transport_t *t, const uint8_t *cmds, size_t cmds_len, const uint8_t *data, size_t len);
+    /** true while data is still being sent */
+    bool (*busy)(ssd1306_transport_t *t);
+    /** let go of what the transport holds for its display, e.g. a place on a shared bus.
+        called by ssd1306_deinit, NULL if there is nothing to release */
+    void (*release)(ssd1306_transport_t *t);
+    /** called from the dma irq when a transfer of ssd1306_transport_dma_start ended, e.g. to
+        start the next part of the write. NULL reports completion with ssd1306_transport_done */
+    void (*dma_done)(ssd1306_transport_t *t);
+} ssd1306_transport_ops_t;
+
+/**
+*	@brief bus health of a transport, see ssd1306_bus_stats
+*
+*	latencies cover blocking transfers, retries and recoveries included.
+*/
+typedef struct {
+    uint32_t writes;		/**< transfers started */
+    uint32_t failures;		/**< transfers that failed after every retry */
+    uint32_t consecutive_failures;	/**< failed transfers since the last one that went through */
+    uint32_t retries;		/**< attempts repeated after a failure */
+    uint32_t nacks;			/**< attempts not acknowledged by the display */
+    uint32_t timeouts;		/**< attempts that ran past their deadline */
+    uint32_t recoveries;	/**< bus recoveries */
+    uint32_t last_us;		/**< duration of the last blocking transfer */
+    uint32_t max_us;		/**< longest blocking transfer */
+    uint64_t total_us;		/**< time spent in blocking transfers */
+} ssd1306_bus_stats_t;
+
+/**
+*	@brief common part of every transport, first member of the concrete transports
+*/
+struct ssd1306_transport {
+    const ssd1306_transport_ops_t *ops;	/**< operations */
+    struct ssd1306 *owner;	/**< display using this transport, set by ssd1306_init_transport */
+    int dma_channel;		/**< dma channel used by write_data_async, -1 if not claimed */
+    int drain_channel;		/**< dma channel emptying the rx fifo during write_data_async, -1 if none */
+    ssd1306_bus_stats_t stats;	/**< bus health */
+};
+
+/**
+*	@brief how the i2c transport bounds and retries a transfer
+*
+*	each attempt gets a deadline of timeout_base_us+len*timeout_per_byte_us.
+*	a failed attempt is repeated up to retries times, waiting backoff_us
+*	before the first retry and twice as long before every next one. after
+*	offline_after failed transfers in a row the display is taken as gone:
+*	transfers fail at once without touching the bus until ssd1306_reset.
+*/
+typedef struct {
+    uint32_t timeout_base_us;		/**< deadline of an empty transfer */
+    uint32_t timeout_per_byte_us;	/**< added to the deadline for every byte */
+    uint8_t retries;				/**< extra attempts per transfer */
+    uint32_t backoff_us;			/**< wait before the first retry */
+    uint8_t offline_after;			/**< failed transfers before giving up, 0 never gives up */
+} ssd1306_i2c_policy_t;
+
+/**
+*	@brief default i2c policy, deadlines fit 100 kHz and faster buses
+*/
+#define SSD1306_I2C_POLICY_DEFAULT {1000, 100, 2, 200, 3}
+
+/**
+*	@brief displays that can share one i2c controller for async flushes
+*/
+#define SSD1306_I2C_BUS_MAX 4
+
+/**
+*	@brief data bytes an async flush sends before another display on the same controller gets a turn
+*/
+#define SSD1306_I2C_CHUNK 128
+
+/**
+*	@brief most commands sent ahead of the data of an async flush
+*/
+#define SSD1306_I2C_ASYNC_CMDS_MAX 8
+
+/**
+*	@brief IC_DATA_CMD words of an async flush: commands, then data split in chunks, each with its control byte
+*/
+#define SSD1306_I2C_WORDS(cmds_len, len) (1+(cmds_len)+(len)+((len)+SSD1306_I2C_CHUNK-1)/SSD1306_I2C_CHUNK)
+
+/**
+*	@brief i2c transport
+*/
+typedef struct {
+    ssd1306_transport_t base;
+    i2c_inst_t *i2c;		/**< i2c connection instance */
+    uint8_t address;		/**< i2c address of display */
+    ssd1306_i2c_policy_t policy;	/**< deadlines and retries */
+    int sda_pin;			/**< sda gpio for bus recovery, -1 if unknown */
+    int scl_pin;			/**< scl gpio for bus recovery, -1 if unknown */
+    uint baudrate;			/**< bus speed restored after a recovery */
+    uint64_t async_deadline;	/**< time_us_64 by which the running async transfer must be done */
+    uint16_t *words;		/**< async flush as IC_DATA_CMD words, every chunk ends with a stop */
+    size_t words_size;		/**< number of words in words */
+    size_t words_len;		/**< words of the queued flush */
+    volatile size_t words_pos;	/**< first word not handed to the bus yet */
+    volatile bool queued;	/**< async flush waiting for or using the bus */
+    volatile bool async_nack;	/**< the display did not acknowledge the last async flush */
+#if defined(SSD1306_STATIC_WIDTH) && defined(SSD1306_STATIC_HEIGHT)
+    uint16_t words_storage[SSD1306_I2C_WORDS(SSD1306_I2C_ASYNC_CMDS_MAX, SSD1306_STATIC_WIDTH*SSD1306_STATIC_HEIGHT/8)]; /**< words memory */
+#endif
+} ssd1306_i2c_t;
+
+/**
+*	@brief most commands sent ahead of the data of an spi async write
+*/
+#define SSD1306_SPI_ASYNC_CMDS_MAX 8
+
+/**
+*	@brief 4-wire spi transport
+*/
+typedef struct {
+    ssd1306_transport_t base;
+    spi_inst_t *spi;		/**< spi connection instance */
+    uint cs_pin;			/**< chip select, active low */
+    uint dc_pin;			/**< data/command select, low for commands */
+    uint8_t async_cmds[SSD1306_SPI_ASYNC_CMDS_MAX];	/**< commands of the async write, sent by dma */
+    const uint8_t *volatile async_data;	/**< data of the async write still to start, NULL once started */
+    size_t async_len;		/**< bytes of async_data */
+    volatile bool queued;	/**< async write on the bus, cs stays low until it ends */
+} ssd1306_spi_t;
+
+/**
+*	@brief in-memory transport for host tests
+*
+*	every write is appended to log framed like an i2c transaction: a
+*	control byte (0x00 commands, 0x40 data) followed by the payload.
+*	async data is cut into SSD1306_I2C_CHUNK byte writes, as on i2c.
+*/
+typedef struct {
+    ssd1306_transport_t base;
+    /** called with every write, see ssd1306_mock_set_sink */
+    void (*sink)(void *ctx, uint8_t control, const uint8_t *payload, size_t len);
+    void *sink_ctx;			/**< first argument of sink */
+    uint8_t *log;			/**< log memory, may be NULL */
+    size_t log_size;		/**< size of log in bytes */
+    size_t log_len;			/**< bytes used in log */
+    uint32_t cmd_writes;	/**< command transactions */
+    uint32_t data_writes;	/**< data transactions */
+    uint32_t data_bytes;	/**< data bytes */
+    uint32_t fail_async;	/**< async writes still to fail as if not acknowledged, nothing of them is logged */
+} ssd1306_mock_t;
+
+/**
+*	@brief set up an i2c transport
+*
+*	the i2c instance and its pins must be initialized by the caller.
+*
+*	@param[out] t : transport
+*	@param[in] i2c : i2c connection instance
+*	@param[in] address : i2c address of display
+*
+*	@return the transport, to pass to ssd1306_init_transport
+*/
+ssd1306_transport_t *ssd1306_i2c_init(ssd1306_i2c_t *t, i2c_inst_t *i2c, uint8_t address);
+
+/**
+*	@brief change the deadlines and retries of an i2c transport
+*
+*	@param[in] t : transport
+*	@param[in] policy : new policy, copied
+*/
+void ssd1306_i2c_set_policy(ssd1306_i2c_t *t, const ssd1306_i2c_policy_t *policy);
+
+/**
+*	@brief allow bus recovery on an i2c transport
+*
+*	without the pins a timed out transfer only aborts the controller.
+*
+*	@param[in] t : transport
+*	@param[in] sda_pin : sda gpio
+*	@param[in] scl_pin : scl gpio
+*	@param[in] baudrate : bus speed to restore after recovering
+*/
+void ssd1306_i2c_set_recovery(ssd1306_i2c_t *t, uint sda_pin, uint scl_pin, uint baudrate);
+
+/**
+*	@brief free a stuck bus
+*
+*	clocks scl until a target holding sda low lets go, sends a stop and
+*	resets the i2c controller. called by the transport after a timeout.
+*
+*	@param[in] t : transport
+*
+*	@return true if both lines are high afterwards, false if they are not or the pins are unknown
+*/
+bool ssd1306_i2c_recover(ssd1306_i2c_t *t);
+
+/**
+*	@brief set up a 4-wire spi transport
+*
+*	the spi instance (mode 0, up to 10 MHz) and its sck/mosi pins must be
+*	initialized by the caller. cs, dc and reset are driven as gpios.
+*
+*	@param[out] t : transport
+*	@param[in] spi : spi connection instance
+*	@param[in] cs_pin : chip select gpio
+*	@param[in] dc_pin : data/command gpio
+*	@param[in] rst_pin : reset gpio, pulsed once; -1 if not connected
+*
+*	@return the transport, to pass to ssd1306_init_transport
+*/
+ssd1306_transport_t *ssd1306_spi_init(ssd1306_spi_t *t, spi_inst_t *spi, uint cs_pin, uint dc_pin, int rst_pin);
+
+/**
+*	@brief set up a mock transport
+*
+*	@param[out] t : transport
+*	@param[in] log : memory for the byte log, may be NULL
+*	@param[in] log_size : size of log in bytes
+*
+*	@return the transport, to pass to ssd1306_init_transport
+*/
+ssd1306_transport_t *ssd1306_mock_init(ssd1306_mock_t *t, uint8_t *log, size_t log_size);
+
+/**
+*	@brief pass every write of a mock transport on, e.g. to the host emulator
+*
+*	@param[in] t : transport
+*	@param[in] sink : called with the control byte and the payload of each write, NULL to stop
+*	@param[in] ctx : first argument of sink
+*/
+void ssd1306_mock_set_sink(ssd1306_mock_t *t, void (*sink)(void *ctx, uint8_t control, const uint8_t *payload, size_t len), void *ctx);
+
+/**
+*	@brief report the end of a write_data_async, called by transports (may be in interrupt context)
+*/
+void ssd1306_transport_done(ssd1306_transport_t *t);
+
+/**
+*	@brief report a write_data_async that failed, e.g. was not acknowledged (may be in interrupt context)
+*
+*	ends the flush like ssd1306_transport_done, but the windows of the
+*	flush not sent yet are dropped instead of started.
+*/
+void ssd1306_transport_failed(ssd1306_transport_t *t);
+
+/**
+*	@brief fill in the common part of a transport, called by the transport init functions
+*/
+void ssd1306_transport_setup(ssd1306_transport_t *t, const ssd1306_transport_ops_t *ops);
+
+/**
+*	@brief send commands through a transport, counting the transfer in its stats
+*/
+bool ssd1306_transport_write_cmds(ssd1306_transport_t *t, const uint8_t *cmds, size_t len);
+
+/**
+*	@brief send display data through a transport, counting the transfer in its stats
+*/
+bool ssd1306_transport_write_data(ssd1306_transport_t *t, uint8_t *data, size_t len);
+
+/**
+*	@brief claim a dma channel that writes to a peripheral fifo for write_data_async
+*
+*	completion is reported through ssd1306_transport_done from the dma irq.
+*
+*	@return true if the channel is ready
+*/
+bool ssd1306_transport_dma_claim(ssd1306_transport_t *t, uint dreq, volatile void *fifo, enum dma_channel_transfer_size size);
+
+/**
+*	@brief claim a second dma channel that empties the rx fifo of the peripheral for write_data_async
+*
+*	the rx fifo fills as the tx fifo is shifted out, so this channel
+*	only ends once the last byte left the wire: its irq, instead of the
+*	one of the first channel, reports the end of a transfer. 8 bit frames.
+*
+*	@return true if the channel is ready
+*/
+bool ssd1306_transport_dma_claim_drain(ssd1306_transport_t *t, uint dreq, const volatile void *fifo);
+
+/**
+*	@brief start the dma channel of a transport, and its drain channel if any
+*/
+void ssd1306_transport_dma_start(ssd1306_transport_t *t, const void *src, uint32_t count);
+
+/**
+*	@brief stop the dma channels of a transport without reporting completion
+*/
+void ssd1306_transport_dma_abort(ssd1306_transport_t *t);
+
+/**
+*	@brief release the dma channels of a transport, if any
+*/
+void ssd1306_transport_dma_release(ssd1306_transport_t *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,506 @@
+/**
+* @file transport_i2c.c
+*
+* i2c transport: every transaction starts with a control byte, 0x00 for
+* commands and 0x40 for display data. every transfer has a deadline and
+* is retried according to the policy of the transport; failures are
+* counted in the transport stats. async flushes of every display on a
+* controller share one dma channel through a round robin arbiter.
+*/
+
+#include <pico/stdlib.h>
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "ssd1306.h"
+
+static const ssd1306_i2c_policy_t default_policy=SSD1306_I2C_POLICY_DEFAULT;
+
+inline static uint32_t i2c_deadline_us(const ssd1306_i2c_t *t, size_t len) {
+    return t->policy.timeout_base_us+len*t->policy.timeout_per_byte_us;
+}
+
+// empty the controller after a transfer that did not finish
+static void i2c_abort(ssd1306_i2c_t *t) {
+    if(ssd1306_i2c_recover(t))
+        return;
+
+    i2c_hw_t *hw=i2c_get_hw(t->i2c);
+    hw->enable|=I2C_IC_ENABLE_ABORT_BITS;
+    for(uint32_t start=time_us_32(); (hw->enable&I2C_IC_ENABLE_ABORT_BITS) && time_us_32()-start<t->policy.timeout_base_us;)
+        tight_loop_contents();
+}
+
+/**
+*	one per i2c controller. async flushes of the displays on a controller
+*	are cut in chunks that end with a stop; the bus hands chunks round robin
+*	to every display with a flush queued, so a second display on the same
+*	controller adds one chunk of latency, not a whole frame. chunks are fed
+*	by the dma channel of the bus and the stop of each one raises the irq
+*	that starts the next. flushes on i2c0 and i2c1 run at the same time.
+*/
+typedef struct {
+    i2c_inst_t *i2c;		// controller
+    ssd1306_i2c_t *members[SSD1306_I2C_BUS_MAX];	// transports that sent an async flush
+    uint8_t count;			// number of members
+    uint8_t next;			// member asked first for the next chunk
+    bool ready;				// dma channel claimed and irq installed
+    uint dma_channel;		// feeds IC_DATA_CMD
+    ssd1306_i2c_t *volatile active;	// member whose chunk is on the wire
+    volatile bool locked;	// a blocking transfer owns the controller
+} i2c_bus_t;
+
+#define I2C_BUS_IRQS (I2C_IC_INTR_MASK_M_STOP_DET_BITS|I2C_IC_INTR_MASK_M_TX_ABRT_BITS)
+
+static i2c_bus_t buses[NUM_I2CS];
+
+inline static i2c_bus_t *i2c_bus_of(ssd1306_i2c_t *t) {
+    i2c_bus_t *bus=&buses[i2c_hw_index(t->i2c)];
+
+    bus->i2c=t->i2c;
+    return bus;
+}
+
+// start the next chunk of t, interrupts must be off
+static void i2c_bus_start(i2c_bus_t *bus, ssd1306_i2c_t *t) {
+    i2c_hw_t *hw=i2c_get_hw(bus->i2c);
+
+    if(hw->tar!=t->address) {
+        hw->enable=0; // tar can only change while the controller is off
+        hw->tar=t->address;
+        hw->enable=1;
+    }
+
+    size_t end=t->words_pos;
+    while(!(t->words[end++]&I2C_IC_DATA_CMD_STOP_BITS));
+
+    bus->active=t;
+    dma_channel_transfer_from_buffer_now(bus->dma_channel, t->words+t->words_pos, end-t->words_pos);
+    t->words_pos=end;
+}
+
+// hand the controller to the next member with a chunk pending, interrupts must be off
+static void i2c_bus_kick(i2c_bus_t *bus) {
+    if(bus->active || bus->locked)
+        return;
+
+    for(uint8_t i=0; i<bus->count; ++i) {
+        const uint8_t n=(bus->next+i)%bus->count;
+        ssd1306_i2c_t *t=bus->members[n];
+
+        if(!t->queued)
+            continue;
+
+        bus->next=(n+1)%bus->count;
+        i2c_bus_start(bus, t);
+        return;
+    }
+}
+
+static void i2c_bus_irq(i2c_bus_t *bus) {
+    i2c_hw_t *hw=i2c_get_hw(bus->i2c);
+    const uint32_t status=hw->intr_stat;
+    ssd1306_i2c_t *t=bus->active;
+
+    if(status&I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        // not acknowledged: the controller flushed its fifo, drop the rest of the flush
+        dma_channel_abort(bus->dma_channel);
+        (void) hw->clr_tx_abrt;
+        bus->active=NULL;
+        if(t) {
+            t->async_nack=true;
+            t->queued=false;
+            ssd1306_transport_failed(&t->base);
+        }
+        if(!(status&I2C_IC_INTR_STAT_R_STOP_DET_BITS))
+            return; // the stop of the aborted chunk starts the next one
+        t=NULL;
+    }
+
+    if(status&I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        (void) hw->clr_stop_det;
+        bus->active=NULL;
+        if(t && t->words_pos>=t->words_len) {
+            t->queued=false;
+            ssd1306_transport_done(&t->base);
+        }
+    }
+
+    i2c_bus_kick(bus);
+}
+
+static void i2c0_bus_irq(void) {
+    i2c_bus_irq(&buses[0]);
+}
+
+static void i2c1_bus_irq(void) {
+    i2c_bus_irq(&buses[1]);
+}
+
+static bool i2c_bus_join(i2c_bus_t *bus, ssd1306_i2c_t *t) {
+    static const irq_handler_t handlers[NUM_I2CS]= {i2c0_bus_irq, i2c1_bus_irq};
+
+    for(uint8_t i=0; i<bus->count; ++i)
+        if(bus->members[i]==t)
+            return true;
+
+    if(bus->count>=SSD1306_I2C_BUS_MAX)
+        return false;
+
+    if(!bus->ready) {
+        const int ch=dma_claim_unused_channel(false);
+        if(ch<0)
+            return false;
+
+        // 16 bit writes to IC_DATA_CMD, so the STOP bit can ride along the last byte of a chunk
+        dma_channel_config c=dma_channel_get_default_config(ch);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, i2c_get_dreq(bus->i2c, true));
+        dma_channel_configure(ch, &c, &i2c_get_hw(bus->i2c)->data_cmd, NULL, 0, false);
+
+        const uint index=i2c_hw_index(bus->i2c);
+        i2c_get_hw(bus->i2c)->intr_mask=I2C_BUS_IRQS;
+        irq_add_shared_handler(I2C0_IRQ+index, handlers[index], PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(I2C0_IRQ+index, true);
+
+        bus->dma_channel=ch;
+        bus->ready=true;
+    }
+
+    bus->members[bus->count]=t;
+    ++bus->count;
+    return true;
+}
+
+// keep chunks off the controller and wait for the one on the wire, false if it does not end in time
+static bool i2c_bus_lock(i2c_bus_t *bus, uint32_t timeout_us) {
+    const uint32_t irq=save_and_disable_interrupts();
+    bus->locked=true;
+    restore_interrupts(irq);
+
+    for(const uint32_t start=time_us_32(); bus->active;)
+        if(time_us_32()-start>=timeout_us)
+            return false;
+
+    // blocking writes poll the stop themselves
+    i2c_get_hw(bus->i2c)->intr_mask=0;
+    return true;
+}
+
+static void i2c_bus_unlock(i2c_bus_t *bus) {
+    i2c_hw_t *hw=i2c_get_hw(bus->i2c);
+    const uint32_t irq=save_and_disable_interrupts();
+
+    if(bus->ready) {
+        (void) hw->clr_intr;
+        hw->intr_mask=I2C_BUS_IRQS; // a recovery resets the controller, mask included
+    }
+    bus->locked=false;
+    i2c_bus_kick(bus);
+    restore_interrupts(irq);
+}
+
+// give up on the async flush of t, the bus must be locked
+static void i2c_bus_drop(i2c_bus_t *bus, ssd1306_i2c_t *t) {
+    const uint32_t irq=save_and_disable_interrupts();
+    const bool running=bus->active==t;
+    const bool queued=t->queued;
+
+    if(running) {
+        i2c_get_hw(bus->i2c)->intr_mask=0;
+        dma_channel_abort(bus->dma_channel);
+        bus->active=NULL;
+    }
+    t->queued=false;
+    restore_interrupts(irq);
+
+    if(running)
+        i2c_abort(t);
+
+    if(queued) {
+        ++t->base.stats.timeouts;
+        ++t->base.stats.failures;
+        ++t->base.stats.consecutive_failures;
+        ssd1306_transport_failed(&t->base); // the last stop never came
+    }
+}
+
+static bool i2c_transfer_locked(ssd1306_i2c_t *t, const uint8_t *src, size_t len) {
+    ssd1306_bus_stats_t *s=&t->base.stats;
+
+    uint32_t backoff=t->policy.backoff_us;
+    for(uint8_t attempt=0;; ++attempt) {
+        const int ret=i2c_write_timeout_us(t->i2c, t->address, src, len, false, i2c_deadline_us(t, len));
+        if(ret==(int) len)
+            return true;
+
+        if(ret==PICO_ERROR_TIMEOUT) {
+            ++s->timeouts;
+            i2c_abort(t);
+        } else {
+            ++s->nacks;
+        }
+
+        if(attempt>=t->policy.retries)
+            return false;
+
+        ++s->retries;
+        busy_wait_us_32(backoff);
+        backoff*=2;
+    }
+}
+
+static bool i2c_transfer(ssd1306_i2c_t *t, const uint8_t *src, size_t len) {
+    if(t->policy.offline_after && t->base.stats.consecutive_failures>=t->policy.offline_after)
+        return false; // display is gone, ssd1306_reset tries again
+
+    // async flushes of other displays on this controller pause between two chunks
+    i2c_bus_t *bus=i2c_bus_of(t);
+    if(!i2c_bus_lock(bus, i2c_deadline_us(t, SSD1306_I2C_CHUNK+1))) {
+        ssd1306_i2c_t *stuck=bus->active;
+        if(stuck)
+            i2c_bus_drop(bus, stuck);
+        i2c_get_hw(t->i2c)->intr_mask=0;
+    }
+
+    const bool ok=i2c_transfer_locked(t, src, len);
+    i2c_bus_unlock(bus);
+
+    return ok;
+}
+
+static bool i2c_write_cmds(ssd1306_transport_t *base, const uint8_t *cmds, size_t len) {
+    ssd1306_i2c_t *t=(ssd1306_i2c_t *) base;
+    uint8_t d[SSD1306_CMD_BATCH_MAX+1];
+    bool ok=true;
+
+    d[0]=0x00; // every following byte is a command
+    while(len) {
+        const size_t n=len<SSD1306_CMD_BATCH_MAX?len:SSD1306_CMD_BATCH_MAX;
+
+        memcpy(d+1, cmds, n);
+        ok&=i2c_transfer(t, d, n+1);
+        cmds+=n;
+        len-=n;
+    }
+
+    return ok;
+}
+
+static bool i2c_write_data(ssd1306_transport_t *base, uint8_t *data, size_t len) {
+    ssd1306_i2c_t *t=(ssd1306_i2c_t *) base;
+    const uint8_t saved=data[-1];
+
+    data[-1]=0x40; // borrow the byte before the data for the control byte
+    const bool ok=i2c_transfer(t, data-1, len+1);
+    data[-1]=saved;
+
+    return ok;
+}
+
+static bool i2c_write_data_async(ssd1306_transport_t *base, const uint8_t *cmds, size_t cmds_len, const uint8_t *data, size_t len) {
+    ssd1306_i2c_t *t=(ssd1306_i2c_t *) base;
+
+    if(t->policy.offline_after && base->stats.consecutive_failures>=t->policy.offline_after)
+        return false;
+
+    i2c_bus_t *bus=i2c_bus_of(t);
+    if(!i2c_bus_join(bus, t))
+        return false;
+
+    const size_t n=SSD1306_I2C_WORDS(cmds_len, len);
+    if(t->words_size<n) {
+#ifdef SSD1306_STATIC_GEOMETRY
+        return false;
+#else
+        free(t->words);
+        if((t->words=malloc(n*sizeof(uint16_t)))==NULL) {
+            t->words_size=0;
+            return false;
+        }
+        t->words_size=n;
+#endif
+    }
+
+    uint16_t *w=t->words;
+    if(cmds_len) {
+        *w++=0x00;
+        for(size_t i=0; i<cmds_len; ++i)
+            *w++=cmds[i];
+        w[-1]|=I2C_IC_DATA_CMD_STOP_BITS;
+    }
+    for(size_t i=0; i<len; i+=SSD1306_I2C_CHUNK) {
+        const size_t chunk=len-i<SSD1306_I2C_CHUNK?len-i:SSD1306_I2C_CHUNK;
+
+        *w++=0x40;
+        for(size_t j=0; j<chunk; ++j)
+            *w++=data[i+j];
+        w[-1]|=I2C_IC_DATA_CMD_STOP_BITS;
+    }
+    t->words_len=w-t->words;
+    t->words_pos=0;
+
+    // the flushes already queued on this controller share the bus with this one
+    size_t backlog=t->words_len;
+    for(uint8_t i=0; i<bus->count; ++i)
+        if(bus->members[i]->queued)
+            backlog+=bus->members[i]->words_len-bus->members[i]->words_pos;
+
+    ++base->stats.writes;
+    t->async_deadline=time_us_64()+i2c_deadline_us(t, backlog);
+
+    const uint32_t irq=save_and_disable_interrupts();
+    t->queued=true;
+    i2c_bus_kick(bus);
+    restore_interrupts(irq);
+
+    return true;
+}
+
+static bool i2c_busy(ssd1306_transport_t *base) {
+    ssd1306_i2c_t *t=(ssd1306_i2c_t *) base;
+
+    if(t->async_nack) {
+        t->async_nack=false;
+        ++base->stats.nacks;
+        ++base->stats.failures;
+        ++base->stats.consecutive_failures;
+    }
+
+    if(!t->queued)
+        return false;
+
+    if(time_us_64()<t->async_deadline)
+        return true;
+
+    // stuck past the deadline: drop the flush and report it as done
+    i2c_bus_t *bus=i2c_bus_of(t);
+    i2c_bus_lock(bus, 0);
+    i2c_bus_drop(bus, t);
+    i2c_bus_unlock(bus);
+
+    return false;
+}
+
+// leave the arbiter of the controller, so it never hands the bus to t again
+static void i2c_release(ssd1306_transport_t *base) {
+    ssd1306_i2c_t *t=(ssd1306_i2c_t *) base;
+    i2c_bus_t *bus=i2c_bus_of(t);
+
+    uint8_t i=0;
+    while(i<bus->count && bus->members[i]!=t)
+        ++i;
+    if(i==bus->count)
+        return; // never sent an async flush
+
+    // a flush past its deadline may still hold the controller
+    i2c_bus_lock(bus, 0);
+    if(bus->active==t || t->queued)
+        i2c_bus_drop(bus, t);
+
+    const uint32_t irq=save_and_disable_interrupts();
+    memmove(bus->members+i, bus->members+i+1, (bus->count-i-1)*sizeof(bus->members[0]));
+    --bus->count;
+    if(bus->next>i)
+        --bus->next;
+    if(bus->next>=bus->count)
+        bus->next=0;
+    restore_interrupts(irq);
+
+    i2c_bus_unlock(bus);
+
+#ifndef SSD1306_STATIC_GEOMETRY
+    free(t->words);
+    t->words=NULL;
+    t->words_size=0;
+#endif
+}
+
+static const ssd1306_transport_ops_t i2c_ops= {
+    .write_cmds=i2c_write_cmds,
+    .write_data=i2c_write_data,
+    .write_data_async=i2c_write_data_async,
+    .busy=i2c_busy,
+    .release=i2c_release,
+};
+
+ssd1306_transport_t *ssd1306_i2c_init(ssd1306_i2c_t *t, i2c_inst_t *i2c, uint8_t address) {
+    ssd1306_transport_setup(&t->base, &i2c_ops);
+    t->i2c=i2c;
+    t->address=address;
+    t->policy=default_policy;
+    t->sda_pin=-1;
+    t->scl_pin=-1;
+    t->baudrate=0;
+    t->async_deadline=0;
+    t->words_len=0;
+    t->words_pos=0;
+    t->queued=false;
+    t->async_nack=false;
+#ifdef SSD1306_STATIC_GEOMETRY
+    t->words=t->words_storage;
+    t->words_size=sizeof(t->words_storage)/sizeof(t->words_storage[0]);
+#else
+    t->words=NULL;
+    t->words_size=0;
+#endif
+
+    return &t->base;
+}
+
+void ssd1306_i2c_set_policy(ssd1306_i2c_t *t, const ssd1306_i2c_policy_t *policy) {
+    t->policy=*policy;
+}
+
+void ssd1306_i2c_set_recovery(ssd1306_i2c_t *t, uint sda_pin, uint scl_pin, uint baudrate) {
+    t->sda_pin=sda_pin;
+    t->scl_pin=scl_pin;
+    t->baudrate=baudrate;
+}
+
+// open drain by hand: low drives the pin, high lets the pull-up win
+inline static void i2c_line(uint pin, bool high) {
+    gpio_set_dir(pin, high?GPIO_IN:GPIO_OUT);
+    busy_wait_us_32(5); // half a 100 kHz clock
+}
+
+bool ssd1306_i2c_recover(ssd1306_i2c_t *t) {
+    if(t->sda_pin<0 || t->scl_pin<0)
+        return false;
+
+    const uint sda=t->sda_pin, scl=t->scl_pin;
+    ++t->base.stats.recoveries;
+
+    i2c_deinit(t->i2c);
+    gpio_set_function(sda, GPIO_FUNC_SIO);
+    gpio_set_function(scl, GPIO_FUNC_SIO);
+    gpio_put(sda, 0);
+    gpio_put(scl, 0);
+    i2c_line(sda, true);
+    i2c_line(scl, true);
+
+    // up to 9 clocks let a target finish the byte it is sending
+    for(int i=0; i<9 && !gpio_get(sda); ++i) {
+        i2c_line(scl, false);
+        i2c_line(scl, true);
+    }
+
+    // stop condition: sda rises while scl is high
+    i2c_line(scl, false);
+    i2c_line(sda, false);
+    i2c_line(scl, true);
+    i2c_line(sda, true);
+
+    const bool released=gpio_get(sda) && gpio_get(scl);
+
+    i2c_init(t->i2c, t->baudrate);
+    gpio_set_function(sda, GPIO_FUNC_I2C);
+    gpio_set_function(scl, GPIO_FUNC_I2C);
+
+    return released;
+}
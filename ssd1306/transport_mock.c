@@ -0,0 +1,90 @@
+/**
+* @file transport_mock.c
+*
+* in-memory transport for host tests, logs the bytes an i2c display
+* would receive
+*/
+
+#include <pico/stdlib.h>
+#include <string.h>
+
+#include "ssd1306.h"
+
+inline static void mock_log(ssd1306_mock_t *t, uint8_t control, const uint8_t *src, size_t len) {
+    if(t->sink)
+        t->sink(t->sink_ctx, control, src, len);
+
+    if(!t->log || t->log_len+len+1>t->log_size)
+        return;
+
+    t->log[t->log_len++]=control;
+    memcpy(t->log+t->log_len, src, len);
+    t->log_len+=len;
+}
+
+static bool mock_write_cmds(ssd1306_transport_t *base, const uint8_t *cmds, size_t len) {
+    ssd1306_mock_t *t=(ssd1306_mock_t *) base;
+
+    ++t->cmd_writes;
+    mock_log(t, 0x00, cmds, len);
+
+    return true;
+}
+
+static bool mock_write_data(ssd1306_transport_t *base, uint8_t *data, size_t len) {
+    ssd1306_mock_t *t=(ssd1306_mock_t *) base;
+
+    ++t->data_writes;
+    t->data_bytes+=len;
+    mock_log(t, 0x40, data, len);
+
+    return true;
+}
+
+static bool mock_write_data_async(ssd1306_transport_t *base, const uint8_t *cmds, size_t cmds_len, const uint8_t *data, size_t len) {
+    ssd1306_mock_t *t=(ssd1306_mock_t *) base;
+
+    if(t->fail_async) {
+        --t->fail_async;
+        ssd1306_transport_failed(base); // address not acknowledged, nothing reached the display
+        return true;
+    }
+
+    mock_write_cmds(base, cmds, cmds_len);
+
+    // same transactions as the i2c arbiter, one write per chunk
+    ++t->data_writes;
+    t->data_bytes+=len;
+    for(size_t pos=0; pos<len; pos+=SSD1306_I2C_CHUNK)
+        mock_log(t, 0x40, data+pos, len-pos<SSD1306_I2C_CHUNK?len-pos:SSD1306_I2C_CHUNK);
+
+    ssd1306_transport_done(base); // completes immediately
+
+    return true;
+}
+
+static bool mock_busy(ssd1306_transport_t *base) {
+    (void) base;
+    return false;
+}
+
+static const ssd1306_transport_ops_t mock_ops= {
+    .write_cmds=mock_write_cmds,
+    .write_data=mock_write_data,
+    .write_data_async=mock_write_data_async,
+    .busy=mock_busy,
+};
+
+ssd1306_transport_t *ssd1306_mock_init(ssd1306_mock_t *t, uint8_t *log, size_t log_size) {
+    memset(t, 0, sizeof(*t));
+    ssd1306_transport_setup(&t->base, &mock_ops);
+    t->log=log;
+    t->log_size=log_size;
+
+    return &t->base;
+}
+
+void ssd1306_mock_set_sink(ssd1306_mock_t *t, void (*sink)(void *ctx, uint8_t control, const uint8_t *payload, size_t len), void *ctx) {
+    t->sink=sink;
+    t->sink_ctx=ctx;
+}
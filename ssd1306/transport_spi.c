@@ -0,0 +1,141 @@
+/**
+* @file transport_spi.c
+*
+* 4-wire spi transport: the dc pin selects between commands (low) and
+* display data (high), there are no control bytes. an async write sends
+* its commands and then its data by dma; a second channel drains the rx
+* fifo and its irq, raised once the last byte is out, flips dc between
+* the two and releases cs at the end, so nothing waits in the irq.
+*/
+
+#include <pico/stdlib.h>
+#include "hardware/spi.h"
+#include <string.h>
+
+#include "ssd1306.h"
+
+inline static void spi_finish(ssd1306_spi_t *t) {
+    while(t->queued || spi_is_busy(t->spi))
+        tight_loop_contents();
+
+    gpio_put(t->cs_pin, 1);
+}
+
+inline static void spi_select(ssd1306_spi_t *t, bool data) {
+    spi_finish(t);
+    gpio_put(t->dc_pin, data);
+    gpio_put(t->cs_pin, 0);
+}
+
+static bool spi_write_cmds(ssd1306_transport_t *base, const uint8_t *cmds, size_t len) {
+    ssd1306_spi_t *t=(ssd1306_spi_t *) base;
+
+    spi_select(t, false);
+    spi_write_blocking(t->spi, cmds, len);
+    spi_finish(t);
+
+    return true;
+}
+
+static bool spi_write_data(ssd1306_transport_t *base, uint8_t *data, size_t len) {
+    ssd1306_spi_t *t=(ssd1306_spi_t *) base;
+
+    spi_select(t, true);
+    spi_write_blocking(t->spi, data, len);
+    spi_finish(t);
+
+    return true;
+}
+
+inline static void spi_start_data(ssd1306_spi_t *t) {
+    const uint8_t *data=t->async_data;
+
+    t->async_data=NULL;
+    gpio_put(t->dc_pin, 1);
+    ssd1306_transport_dma_start(&t->base, data, t->async_len);
+}
+
+static bool spi_write_data_async(ssd1306_transport_t *base, const uint8_t *cmds, size_t cmds_len, const uint8_t *data, size_t len) {
+    ssd1306_spi_t *t=(ssd1306_spi_t *) base;
+    spi_hw_t *hw=spi_get_hw(t->spi);
+
+    if(cmds_len>SSD1306_SPI_ASYNC_CMDS_MAX)
+        return false;
+    if(!ssd1306_transport_dma_claim(base, spi_get_dreq(t->spi, true), &hw->dr, DMA_SIZE_8)
+            || !ssd1306_transport_dma_claim_drain(base, spi_get_dreq(t->spi, false), &hw->dr))
+        return false;
+
+    // chained from the irq of the previous window the bus is idle already, nothing waits here
+    spi_finish(t);
+
+    // cmds may live on the stack of the caller
+    memcpy(t->async_cmds, cmds, cmds_len);
+    t->async_data=data;
+    t->async_len=len;
+    t->queued=true;
+
+    gpio_put(t->cs_pin, 0);
+    if(cmds_len) {
+        gpio_put(t->dc_pin, 0);
+        ssd1306_transport_dma_start(base, t->async_cmds, cmds_len);
+    } else {
+        spi_start_data(t);
+    }
+
+    return true;
+}
+
+// in the dma irq, once the last byte of the commands or the data is out
+static void spi_dma_done(ssd1306_transport_t *base) {
+    ssd1306_spi_t *t=(ssd1306_spi_t *) base;
+
+    if(t->async_data) {
+        spi_start_data(t);
+        return;
+    }
+
+    gpio_put(t->cs_pin, 1); // the bus is free for other devices
+    t->queued=false;
+    ssd1306_transport_done(base);
+}
+
+static bool spi_busy(ssd1306_transport_t *base) {
+    ssd1306_spi_t *t=(ssd1306_spi_t *) base;
+
+    return t->queued || spi_is_busy(t->spi);
+}
+
+static const ssd1306_transport_ops_t spi_ops= {
+    .write_cmds=spi_write_cmds,
+    .write_data=spi_write_data,
+    .write_data_async=spi_write_data_async,
+    .busy=spi_busy,
+    .dma_done=spi_dma_done,
+};
+
+ssd1306_transport_t *ssd1306_spi_init(ssd1306_spi_t *t, spi_inst_t *spi, uint cs_pin, uint dc_pin, int rst_pin) {
+    ssd1306_transport_setup(&t->base, &spi_ops);
+    t->spi=spi;
+    t->cs_pin=cs_pin;
+    t->dc_pin=dc_pin;
+    t->async_data=NULL;
+    t->async_len=0;
+    t->queued=false;
+
+    gpio_init(cs_pin);
+    gpio_set_dir(cs_pin, GPIO_OUT);
+    gpio_put(cs_pin, 1);
+    gpio_init(dc_pin);
+    gpio_set_dir(dc_pin, GPIO_OUT);
+
+    if(rst_pin>=0) {
+        gpio_init(rst_pin);
+        gpio_set_dir(rst_pin, GPIO_OUT);
+        gpio_put(rst_pin, 0);
+        sleep_us(10); // at least 3 us low
+        gpio_put(rst_pin, 1);
+        sleep_us(10);
+    }
+
+    return &t->base;
+}
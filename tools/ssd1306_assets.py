@@ -0,0 +1,323 @@
+#!/usr/bin/env python3
+"""
+ssd1306_assets.py
+
+compiles screen sources into run-length compressed images in native
+ssd1306 page order (see ssd1306/image.h), as const arrays for flash.
+
+sources:
+  *.pbm  plain (P1) or raw (P4) bitmap, a 1 bit lights the pixel
+  *.bmp  uncompressed 1, 24 or 32 bit bitmap, non-black pixels are lit
+  *.txt  text layout, one directive per line, # starts a comment:
+           size W H              canvas size, H a multiple of 8 (default 128 64)
+           text X Y SCALE STRING string drawn with the font, as ssd1306_draw_string
+           image X Y FILE        pbm or bmp drawn at X, Y (path relative to the layout)
+           fill X Y W H          lit rectangle
+           clear X Y W H         dark rectangle
+
+every source becomes one ssd1306_image_t named <prefix><file stem>.
+
+usage: ssd1306_assets.py --font font.h --name telas -o outdir [--prefix tela_] sources...
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+RUN_MIN = 2
+RUN_MAX = 129   # 0x80|(n-2)
+LIT_MAX = 128   # n-1
+
+
+class Canvas:
+    def __init__(self, width, height):
+        if width < 1 or width > 128 or height < 8 or height > 64 or height % 8:
+            raise ValueError('canvas must be 1..128 wide and 8..64 high, height a multiple of 8')
+        self.width = width
+        self.height = height
+        self.px = [[0] * width for _ in range(height)]
+
+    def set(self, x, y, on=1):
+        if 0 <= x < self.width and 0 <= y < self.height:
+            self.px[y][x] = on
+
+    def rect(self, x, y, w, h, on):
+        for yy in range(y, y + h):
+            for xx in range(x, x + w):
+                self.set(xx, yy, on)
+
+    def blit(self, other, x, y):
+        for yy in range(other.height):
+            for xx in range(other.width):
+                if other.px[yy][xx]:
+                    self.set(x + xx, y + yy)
+
+    def pages(self):
+        """framebuffer bytes, page after page, bit 0 on top"""
+        out = bytearray()
+        for page in range(self.height // 8):
+            for x in range(self.width):
+                b = 0
+                for bit in range(8):
+                    if self.px[page * 8 + bit][x]:
+                        b |= 1 << bit
+                out.append(b)
+        return bytes(out)
+
+
+class Bitmap:
+    """any width and height, only used as a blit source"""
+    def __init__(self, width, height):
+        self.width = width
+        self.height = height
+        self.px = [[0] * width for _ in range(height)]
+
+
+def load_font(path, name='font_8x5'):
+    text = open(path).read()
+    m = re.search(r'\b' + re.escape(name) + r'\s*\[\s*\]\s*=\s*\{(.*?)\}', text, re.S)
+    if not m:
+        raise ValueError('%s not found in %s' % (name, path))
+    body = re.sub(r'/\*.*?\*/|//[^\n]*', '', m.group(1), flags=re.S)
+    data = [int(v, 0) for v in re.findall(r'0[xX][0-9a-fA-F]+|\d+', body)]
+    if data[0] > 8:
+        raise ValueError('only fonts 8 pixels high are supported')
+    return data
+
+
+def draw_text(canvas, font, x, y, scale, s):
+    height, width, spacing, first, last = font[:5]
+    for c in s:
+        o = ord(c)
+        if first <= o <= last:
+            base = 5 + (o - first) * width
+            for w in range(width):
+                col = font[base + w]
+                for bit in range(height):
+                    if col >> bit & 1:
+                        canvas.rect(x + w * scale, y + bit * scale, scale, scale, 1)
+        x += (width + spacing) * scale
+
+
+def pbm_tokens(data):
+    tokens = []
+    i = 0
+    while len(tokens) < 3:
+        while data[i:i + 1].isspace():
+            i += 1
+        if data[i:i + 1] == b'#':
+            while data[i:i + 1] not in (b'\n', b''):
+                i += 1
+            continue
+        j = i
+        while not data[j:j + 1].isspace():
+            j += 1
+        tokens.append(data[i:j])
+        i = j
+    return tokens, i + 1
+
+
+def load_pbm(path):
+    data = open(path, 'rb').read()
+    (magic, w, h), pos = pbm_tokens(data)
+    w, h = int(w), int(h)
+    bmp = Bitmap(w, h)
+    if magic == b'P1':
+        bits = [int(c) for c in re.findall(rb'[01]', re.sub(rb'#[^\n]*', b'', data[pos:]))]
+        for y in range(h):
+            for x in range(w):
+                bmp.px[y][x] = bits[y * w + x]
+    elif magic == b'P4':
+        stride = (w + 7) // 8
+        for y in range(h):
+            row = data[pos + y * stride:pos + (y + 1) * stride]
+            for x in range(w):
+                bmp.px[y][x] = row[x >> 3] >> (7 - (x & 7)) & 1
+    else:
+        raise ValueError('%s: only P1 and P4 bitmaps are supported' % path)
+    return bmp
+
+
+def load_bmp(path):
+    data = open(path, 'rb').read()
+    if data[:2] != b'BM':
+        raise ValueError('%s: not a bmp' % path)
+    off, = struct.unpack_from('<I', data, 10)
+    hsize, w, h = struct.unpack_from('<Iii', data, 14)
+    bpp, comp = struct.unpack_from('<HI', data, 28)
+    if comp not in (0, 3) or bpp not in (1, 24, 32):
+        raise ValueError('%s: only uncompressed 1, 24 and 32 bit bmps are supported' % path)
+    top_down = h < 0
+    h = abs(h)
+    stride = ((w * bpp + 31) // 32) * 4
+    palette = []
+    if bpp == 1:
+        for i in range(2):
+            b, g, r = data[14 + hsize + i * 4:14 + hsize + i * 4 + 3]
+            palette.append(1 if (r, g, b) != (0, 0, 0) else 0)
+    bmp = Bitmap(w, h)
+    for y in range(h):
+        row = off + (y if top_down else h - 1 - y) * stride
+        for x in range(w):
+            if bpp == 1:
+                bmp.px[y][x] = palette[data[row + (x >> 3)] >> (7 - (x & 7)) & 1]
+            else:
+                b, g, r = data[row + x * bpp // 8:row + x * bpp // 8 + 3]
+                bmp.px[y][x] = 1 if (r * 299 + g * 587 + b * 114) // 1000 >= 128 else 0
+    return bmp
+
+
+def load_bitmap(path):
+    if path.lower().endswith('.pbm'):
+        return load_pbm(path)
+    if path.lower().endswith('.bmp'):
+        return load_bmp(path)
+    raise ValueError('%s: unknown image type' % path)
+
+
+def bitmap_canvas(bmp):
+    height = (bmp.height + 7) // 8 * 8
+    canvas = Canvas(bmp.width, height)
+    canvas.blit(bmp, 0, 0)
+    return canvas
+
+
+def load_layout(path, font):
+    canvas = None
+    for n, raw in enumerate(open(path), 1):
+        line = raw.rstrip('\n')
+        if not line.strip() or line.lstrip().startswith('#'):
+            continue
+        words = line.split()
+        try:
+            cmd = words[0]
+            if cmd == 'size':
+                if canvas is not None:
+                    raise ValueError('size must come first')
+                canvas = Canvas(int(words[1]), int(words[2]))
+                continue
+            if canvas is None:
+                canvas = Canvas(128, 64)
+            if cmd == 'text':
+                # the string is the rest of the line after the scale, spaces kept
+                m = re.match(r'\s*text\s+(-?\d+)\s+(-?\d+)\s+(\d+)\s(.*)$', line)
+                draw_text(canvas, font, int(m.group(1)), int(m.group(2)), int(m.group(3)), m.group(4))
+            elif cmd == 'image':
+                canvas.blit(load_bitmap(os.path.join(os.path.dirname(path), words[3])), int(words[1]), int(words[2]))
+            elif cmd in ('fill', 'clear'):
+                canvas.rect(*(int(v) for v in words[1:5]), on=1 if cmd == 'fill' else 0)
+            else:
+                raise ValueError('unknown directive %s' % cmd)
+        except (IndexError, AttributeError, ValueError) as e:
+            raise ValueError('%s:%d: %s' % (path, n, e))
+    return canvas or Canvas(128, 64)
+
+
+def rle(data):
+    """
+    control byte c, then:
+      c&0x80: one byte repeated (c&0x7f)+2 times
+      else:   c+1 literal bytes
+    """
+    out = bytearray()
+    lit = bytearray()
+
+    def flush_lit():
+        while lit:
+            n = min(len(lit), LIT_MAX)
+            out.append(n - 1)
+            out.extend(lit[:n])
+            del lit[:n]
+
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < RUN_MAX:
+            run += 1
+        # a run of two inside literals costs as much as the literals, keep it literal
+        if run > 2 or (run == 2 and not lit):
+            flush_lit()
+            out.append(0x80 | (run - RUN_MIN))
+            out.append(data[i])
+            i += run
+        else:
+            lit.append(data[i])
+            i += 1
+    flush_lit()
+    return bytes(out)
+
+
+def unrle(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        c = data[i]
+        if c & 0x80:
+            out.extend(bytes([data[i + 1]]) * ((c & 0x7f) + RUN_MIN))
+            i += 2
+        else:
+            out.extend(data[i + 1:i + 2 + c])
+            i += c + 2
+    return bytes(out)
+
+
+def c_name(prefix, path):
+    stem = os.path.splitext(os.path.basename(path))[0]
+    return prefix + re.sub(r'\W', '_', stem)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='compile ssd1306 screens into rle page-format images')
+    ap.add_argument('--font', required=True, help='header with the font used by text directives')
+    ap.add_argument('--font-name', default='font_8x5')
+    ap.add_argument('--name', required=True, help='base name of the generated .c and .h')
+    ap.add_argument('--prefix', default='', help='prefix of every image symbol')
+    ap.add_argument('--include', default='ssd1306/image.h', help='header declaring ssd1306_image_t')
+    ap.add_argument('-o', '--outdir', default='.')
+    ap.add_argument('sources', nargs='+')
+    args = ap.parse_args()
+
+    try:
+        font = load_font(args.font, args.font_name)
+        images = []
+        for src in args.sources:
+            if src.lower().endswith('.txt'):
+                canvas = load_layout(src, font)
+            else:
+                canvas = bitmap_canvas(load_bitmap(src))
+            raw = canvas.pages()
+            packed = rle(raw)
+            assert unrle(packed) == raw
+            images.append((c_name(args.prefix, src), src, canvas, raw, packed))
+    except (OSError, ValueError) as e:
+        sys.exit('ssd1306_assets: %s' % e)
+
+    guard = '_inc_' + re.sub(r'\W', '_', args.name)
+    h = ['/* generated by ssd1306_assets.py, do not edit */', '',
+         '#ifndef ' + guard, '#define ' + guard, '#include "%s"' % args.include, '',
+         '#ifdef __cplusplus', 'extern "C" {', '#endif', '']
+    c = ['/* generated by ssd1306_assets.py, do not edit */', '',
+         '#include "%s.h"' % args.name, '']
+    for name, src, canvas, raw, packed in images:
+        h.append('extern const ssd1306_image_t %s; /* %s, %ux%u, %u of %u bytes */'
+                 % (name, os.path.basename(src), canvas.width, canvas.height, len(packed), len(raw)))
+        c.append('static const uint8_t %s_data[%u]= {' % (name, len(packed)))
+        for i in range(0, len(packed), 16):
+            c.append('    ' + ', '.join('0x%02x' % b for b in packed[i:i + 16]) + ',')
+        c.append('};')
+        c.append('')
+        c.append('const ssd1306_image_t %s= {%u, %u, %u, %s_data};' % (name, canvas.width, canvas.height, len(packed), name))
+        c.append('')
+    h += ['', '#ifdef __cplusplus', '}', '#endif', '', '#endif', '']
+
+    os.makedirs(args.outdir, exist_ok=True)
+    for ext, lines in (('.h', h), ('.c', c)):
+        path = os.path.join(args.outdir, args.name + ext)
+        with open(path, 'w') as f:
+            f.write('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    main()
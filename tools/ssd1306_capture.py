@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""
+ssd1306_capture.py
+
+rebuilds the frames sent by the capture tap (see ssd1306/capture.h) from
+a usb cdc port or a file saved from it, into a png sequence and/or a
+video. text printed on the same port is skipped.
+
+usage:
+  ssd1306_capture.py /dev/ttyACM0 -o frames/            png per frame
+  ssd1306_capture.py capture.bin --video tela.mp4       needs ffmpeg
+  ssd1306_capture.py capture.bin --stats                packets only
+"""
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import zlib
+
+SYNC = b'\xa5\x5a'
+HEADER = 13
+MAX_PAYLOAD = 8 * 128 * 3 // 2
+
+
+def unrle(data, size):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        c = data[i]
+        if c & 0x80:
+            out.extend(bytes([data[i + 1]]) * ((c & 0x7f) + 2))
+            i += 2
+        else:
+            out.extend(data[i + 1:i + 2 + c])
+            i += c + 2
+    if len(out) != size:
+        raise ValueError('payload decodes to %u bytes, expected %u' % (len(out), size))
+    return out
+
+
+def packets(stream, stats):
+    """yields (type, width, height, seq, time_us, payload) of every valid packet"""
+    buf = bytearray()
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            at = buf.find(SYNC)
+            if at < 0:
+                stats['skipped'] += max(len(buf) - 1, 0)
+                del buf[:max(len(buf) - 1, 0)]
+                break
+            stats['skipped'] += at
+            del buf[:at]
+            if len(buf) < HEADER:
+                break
+            kind, width, height, seq, time_us, length = struct.unpack_from('<cBBHIH', buf, 2)
+            if kind not in (b'K', b'D') or length > MAX_PAYLOAD or height % 8 or not width:
+                stats['skipped'] += 1
+                del buf[:1]
+                continue
+            if len(buf) < HEADER + length + 1:
+                break
+            check = 0
+            for b in buf[2:HEADER + length]:
+                check ^= b
+            if check != buf[HEADER + length]:
+                stats['bad'] += 1
+                del buf[:1]
+                continue
+            payload = bytes(buf[HEADER:HEADER + length])
+            del buf[:HEADER + length + 1]
+            yield kind, width, height, seq, time_us, payload
+
+
+def frames(stream, stats):
+    """yields (time_us, width, height, framebuffer) of every frame rebuilt"""
+    fb = None
+    last_seq = None
+    time_base = 0
+    last_time = None
+    for kind, width, height, seq, time_us, payload in packets(stream, stats):
+        stats['packets'] += 1
+        stats['bytes'] += HEADER + len(payload) + 1
+
+        # time_us_32 wraps every 71 minutes
+        if last_time is not None and time_us < last_time:
+            time_base += 1 << 32
+        last_time = time_us
+
+        if last_seq is not None and seq != (last_seq + 1) & 0xffff:
+            stats['lost'] += (seq - last_seq - 1) & 0xffff
+            fb = None  # deltas from here on are useless until a key frame
+        last_seq = seq
+
+        size = width * height // 8
+        try:
+            diff = unrle(payload, size)
+        except (ValueError, IndexError):
+            stats['bad'] += 1
+            fb = None
+            continue
+
+        if kind == b'K':
+            fb = diff
+        elif fb is None or len(fb) != size:
+            stats['waiting'] += 1
+            continue
+        else:
+            fb = bytearray(a ^ b for a, b in zip(fb, diff))
+
+        stats['frames'] += 1
+        yield time_base + time_us, width, height, bytes(fb)
+
+
+def pixels(width, height, fb, scale):
+    """rows of 8 bit gray pixels, scaled up"""
+    rows = []
+    for y in range(height):
+        page = (y >> 3) * width
+        bit = y & 7
+        row = bytearray()
+        for x in range(width):
+            row.extend(b'\xff' * scale if fb[page + x] >> bit & 1 else b'\x00' * scale)
+        rows.extend([bytes(row)] * scale)
+    return rows
+
+
+def write_png(path, rows):
+    def chunk(tag, data):
+        c = struct.pack('>I', len(data)) + tag + data
+        return c + struct.pack('>I', zlib.crc32(tag + data) & 0xffffffff)
+
+    width, height = len(rows[0]), len(rows)
+    raw = b''.join(b'\x00' + r for r in rows)
+    with open(path, 'wb') as f:
+        f.write(b'\x89PNG\r\n\x1a\n')
+        f.write(chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 0, 0, 0, 0)))
+        f.write(chunk(b'IDAT', zlib.compress(raw, 9)))
+        f.write(chunk(b'IEND', b''))
+
+
+def open_input(path):
+    f = open(path, 'rb', buffering=0)
+    if os.isatty(f.fileno()):
+        import tty
+        tty.setraw(f.fileno())  # no newline translation or echo on the cdc port
+    return f
+
+
+def main():
+    ap = argparse.ArgumentParser(description='rebuild frames from the ssd1306 capture stream')
+    ap.add_argument('input', help='usb cdc port or captured file')
+    ap.add_argument('-o', '--outdir', help='write frame_NNNNN.png files here')
+    ap.add_argument('--video', help='write a video here, through ffmpeg')
+    ap.add_argument('--fps', type=int, default=30, help='frame rate of the video')
+    ap.add_argument('--scale', type=int, default=4, help='pixels per panel pixel')
+    ap.add_argument('--stats', action='store_true', help='print packet statistics')
+    args = ap.parse_args()
+
+    stats = dict(packets=0, frames=0, bytes=0, skipped=0, bad=0, lost=0, waiting=0)
+    ffmpeg = None
+    video_time = None
+    last = None
+    n = 0
+
+    if args.outdir:
+        os.makedirs(args.outdir, exist_ok=True)
+    if args.video and not shutil.which('ffmpeg'):
+        sys.exit('ssd1306_capture: ffmpeg not found, use -o for a png sequence')
+
+    try:
+        for time_us, width, height, fb in frames(open_input(args.input), stats):
+            if args.outdir:
+                write_png(os.path.join(args.outdir, 'frame_%05u.png' % n), pixels(width, height, fb, args.scale))
+            if args.video:
+                if ffmpeg is None:
+                    ffmpeg = subprocess.Popen(['ffmpeg', '-loglevel', 'error', '-y', '-f', 'rawvideo',
+                                               '-pix_fmt', 'gray', '-s', '%ux%u' % (width * args.scale, height * args.scale),
+                                               '-r', str(args.fps), '-i', '-', '-pix_fmt', 'yuv420p', args.video],
+                                              stdin=subprocess.PIPE)
+                    video_time = time_us
+                # repeat the previous frame until this one is due, so the video keeps the real timing
+                while last is not None and video_time + 1000000 // args.fps <= time_us:
+                    ffmpeg.stdin.write(last)
+                    video_time += 1000000 // args.fps
+                last = b''.join(pixels(width, height, fb, args.scale))
+            n += 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if ffmpeg is not None:
+            if last is not None:
+                ffmpeg.stdin.write(last)
+            ffmpeg.stdin.close()
+            ffmpeg.wait()
+
+    if args.stats or not (args.outdir or args.video):
+        print('%(packets)u packets, %(frames)u frames, %(bytes)u bytes; %(lost)u lost, %(bad)u bad, '
+              '%(waiting)u deltas without a key frame, %(skipped)u other bytes skipped' % stats)
+
+
+if __name__ == '__main__':
+    main()